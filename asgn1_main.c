@@ -0,0 +1,1219 @@
+/**
+* File: asgn1_main.c
+* Date: 12/09/2017
+* Author: Patrick Skinner
+* Version: 0.1
+*
+* This is a module which serves as a virtual ramdisk which disk size is
+* limited by the amount of memory available and serves as the requirement for
+* COSC440 assignment 1 in 2012.
+*
+* Note: multiple devices and concurrent modules are not supported in this
+*       version.
+*/
+
+/* This program is free software; you can redistribute it and/or
+* modify it under the terms of the GNU General Public License
+* as published by the Free Software Foundation; either version
+* 2 of the License, or (at your option) any later version.
+*/
+
+#include <linux/init.h>
+#include <linux/module.h>
+#include <linux/fs.h>
+#include <linux/cdev.h>
+#include <linux/list.h>
+#include <asm/uaccess.h>
+#include <linux/slab.h>
+#include <linux/mm.h>
+#include <linux/proc_fs.h>
+#include <linux/seq_file.h>
+#include <linux/device.h>
+#include <linux/sched.h>
+#include <linux/mutex.h>
+#include <linux/spinlock.h>
+#include <linux/workqueue.h>
+#include <linux/kthread.h>
+#include <linux/delay.h>
+#include <linux/crc32.h>
+#include <linux/crc32c.h>
+
+#include "asgn1_store.h"
+
+#define MYDEV_NAME "asgn1"
+#define MYIOC_TYPE 'k'
+#define RECLAIM_BATCH 64  /* pages freed by the reclaim worker per batch */
+#define SCRUB_INTERVAL_MS 100  /* the scrubber wakes up this often */
+#define EVICT_BATCH 32    /* pages written back by the evictor per batch */
+#define READAHEAD_PAGES 8 /* evicted pages brought back along with a faulting one */
+
+MODULE_LICENSE("GPL");
+MODULE_AUTHOR("Patrick Skinner");
+MODULE_DESCRIPTION("COSC440 asgn1");
+
+static bool integrity = false;
+module_param(integrity, bool, 0444);
+MODULE_PARM_DESC(integrity, "Keep a CRC32C per page, verify it on read and scrub in the background");
+
+static unsigned int scrub_rate = 2560;
+module_param(scrub_rate, uint, 0644);
+MODULE_PARM_DESC(scrub_rate, "Maximum number of pages the scrubber verifies per second");
+
+static char *backing_file = NULL;
+module_param(backing_file, charp, 0444);
+MODULE_PARM_DESC(backing_file, "File cold pages are evicted to, created if it doesn't exist");
+
+static unsigned long ram_pages = 0;
+module_param(ram_pages, ulong, 0444);
+MODULE_PARM_DESC(ram_pages, "Pages kept in memory when backing_file is set, 0 for no limit");
+
+
+/**
+* A page being written back by the evictor.
+*/
+struct evict_victim {
+	page_node *node;
+	struct page *page;   /* extra reference held while it is written */
+	long page_no;
+	bool written;
+};
+
+typedef struct asgn1_dev_t {
+	dev_t dev;            /* the device */
+	struct cdev *cdev;
+	asgn1_store store;     /* the pages and data size of this module */
+	atomic_t nprocs;      /* number of processes accessing this device */ 
+	atomic_t max_nprocs;  /* max number of processes accessing this device */
+	struct kmem_cache *cache;      /* cache memory */
+	struct class *class;     /* the udev class */
+	struct device *device;   /* the udev device node */
+	struct mutex lock;       /* serialises access to mem_list and sizes */
+	unsigned long generation;        /* bumped on every logical wipe */
+	spinlock_t reclaim_lock;         /* protects the two reclaim lists */
+	struct list_head reclaim_nodes;  /* wiped page nodes waiting to be freed */
+	struct list_head reclaim_pages;  /* discarded pages, linked by page->lru */
+	struct work_struct reclaim_work; /* frees reclaimed pages in batches */
+	atomic_t mmaps;                  /* number of mappings of the device */
+	atomic_t mmap_writers;           /* number of shared writable mappings */
+	struct task_struct *scrubber;    /* background checksum scrubber */
+	unsigned long csum_errors;       /* checksum mismatches found so far */
+	unsigned long scrubbed_pages;    /* pages verified by the scrubber */
+	long last_bad_page;              /* page number of the last mismatch, -1 if none */
+	struct file *backing;            /* second tier for evicted pages, or NULL */
+	struct work_struct evict_work;   /* writes cold pages back to the backing file */
+	page_node *clock_hand;           /* next page the evictor looks at */
+	unsigned long clock_gen;         /* generation clock_hand belongs to */
+	long clock_page_no;              /* page number of clock_hand */
+	unsigned long evictions;         /* pages evicted to the backing file */
+	unsigned long swapins;           /* pages read back from the backing file */
+	unsigned long writeback_errors;  /* failed writes to the backing file */
+	bool evict_failed;               /* the last evictor pass hit a write error */
+	unsigned long evict_reserve;     /* pages to evict beyond ram_pages after an allocation failed */
+	struct evict_victim evict_batch[EVICT_BATCH]; /* evictor scratch, too big for its stack */
+} asgn1_dev;
+
+asgn1_dev asgn1_device;
+struct prod_dir_entry *asgn1_proc;
+
+int asgn1_major = 0;                      /* major number of module */  
+int asgn1_minor = 0;                      /* minor number of module */
+int asgn1_dev_count = 1;                  /* number of devices */
+
+/* x^(8n) modulo the CRC32C polynomial for n < PAGE_SIZE, moves a crc n bytes on */
+static u32 csum_shift[PAGE_SIZE];
+
+/**
+* Compute the checksum of a whole page. Only the scrubber does this, for pages
+* written in full, which writes leave unsealed rather than hashing them while
+* the caller waits, and for pages unsealed by writable mappings once those
+* are gone. Pages that are mapped shared and writable can change behind our
+* back, so they are left unsealed meanwhile.
+*/
+static void seal_page(page_node *node) {
+	node->corrupt = false;
+	if(!integrity || node->page == NULL || atomic_read(&asgn1_device.mmap_writers) > 0){
+		node->sealed = false;
+		return;
+	}
+
+	node->csum = crc32c(~0, page_address(node->page), PAGE_SIZE);
+	node->sealed = true;
+}
+
+
+/**
+* Multiply two polynomials modulo the CRC32C polynomial, both bit reflected
+* the way crc32c() keeps its crc.
+*/
+static u32 csum_multiply(u32 a, u32 b) {
+	u32 product = 0;
+	int i;
+
+	for(i = 31; i >= 0; i--){
+		product ^= b & -((a >> i) & 1);
+		b = (b >> 1) ^ (0x82f63b78 & -(b & 1));
+	}
+	return product;
+}
+
+
+/**
+* Fold len bytes at offset into the checksum of a sealed page, or back out of
+* it. CRC32C is linear, so the crc of the page changes by the crc of the
+* range, shifted past the rest of the page; calling this before and after a
+* partial write keeps the checksum current for the cost of hashing only the
+* bytes written. Caller must hold asgn1_device.lock.
+*/
+static void update_csum(page_node *node, size_t offset, size_t len) {
+	if(!integrity || atomic_read(&asgn1_device.mmap_writers) > 0){
+		node->sealed = false;
+		return;
+	}
+
+	node->csum ^= csum_multiply(crc32c(0, page_address(node->page) + offset, len),
+	csum_shift[PAGE_SIZE - offset - len]);
+}
+
+
+/**
+* Check a page against its stored checksum, returns -EIO if the page has been
+* corrupted. Each corrupt page is only recorded once, however often it is
+* read or scrubbed. Caller must hold asgn1_device.lock.
+*/
+static int verify_page(page_node *node, long page_no) {
+	if(!integrity || node->page == NULL || !node->sealed){
+		return 0;
+	}
+
+	if(node->corrupt){
+		return -EIO;
+	}
+
+	if(crc32c(~0, page_address(node->page), PAGE_SIZE) != node->csum){
+		node->corrupt = true;
+		asgn1_device.csum_errors++;
+		asgn1_device.last_bad_page = page_no;
+		printk(KERN_ERR "%s: checksum mismatch on page %ld\n", MYDEV_NAME, page_no);
+		return -EIO;
+	}
+	return 0;
+}
+
+
+/**
+* This function frees all memory pages held by the module, including any
+* still waiting on the reclaim lists. Only used on module exit, once the
+* reclaim worker has been flushed.
+*/
+void free_memory_pages(void) {
+	struct page *page;
+	struct page *next;
+
+	/* Hand the live list over to the reclaim list, then empty it. */
+	list_splice_init(&asgn1_device.store.mem_list, &asgn1_device.reclaim_nodes);
+	store_free_nodes(&asgn1_device.reclaim_nodes);
+
+	list_for_each_entry_safe(page, next, &asgn1_device.reclaim_pages, lru){
+		list_del(&page->lru);
+		__free_page(page);
+	}
+
+	/* reset device data size, and num_pages */
+	asgn1_device.store.num_pages = 0;
+	asgn1_device.store.data_size = 0;
+	asgn1_device.store.nr_resident = 0;
+}
+
+
+/**
+* Background worker which frees wiped and discarded pages. Pages are taken
+* off the reclaim lists RECLAIM_BATCH at a time so the lock is never held
+* for long and the worker yields between batches.
+*/
+static void reclaim_worker(struct work_struct *work) {
+	LIST_HEAD(batch);
+	struct page *page;
+	struct page *next;
+	int n;
+
+	for(;;){
+		n = 0;
+
+		spin_lock(&asgn1_device.reclaim_lock);
+		while(n < RECLAIM_BATCH && !list_empty(&asgn1_device.reclaim_nodes)){
+			list_move(asgn1_device.reclaim_nodes.next, &batch);
+			n++;
+		}
+		spin_unlock(&asgn1_device.reclaim_lock);
+
+		store_free_nodes(&batch);
+
+		spin_lock(&asgn1_device.reclaim_lock);
+		while(n < RECLAIM_BATCH && !list_empty(&asgn1_device.reclaim_pages)){
+			list_move(asgn1_device.reclaim_pages.next, &batch);
+			n++;
+		}
+		spin_unlock(&asgn1_device.reclaim_lock);
+
+		list_for_each_entry_safe(page, next, &batch, lru){
+			list_del(&page->lru);
+			__free_page(page);
+		}
+
+		/* Both lists were drained before the batch filled up. */
+		if(n < RECLAIM_BATCH){
+			break;
+		}
+		cond_resched();
+	}
+}
+
+
+/**
+* Logically wipe the device in O(1): the whole page list is spliced onto the
+* reclaim list and the device is left with an empty one. The pages are freed
+* later by reclaim_worker. Mapped pages are not refcounted by remap_pfn_range,
+* so the wipe is refused with -EBUSY while the device is mapped. Caller must
+* hold asgn1_device.lock.
+*/
+int wipe_memory_pages(void) {
+	if(atomic_read(&asgn1_device.mmaps) > 0){
+		return -EBUSY;
+	}
+
+	spin_lock(&asgn1_device.reclaim_lock);
+	list_splice_tail_init(&asgn1_device.store.mem_list, &asgn1_device.reclaim_nodes);
+	spin_unlock(&asgn1_device.reclaim_lock);
+
+	asgn1_device.store.num_pages = 0;
+	asgn1_device.store.data_size = 0;
+	asgn1_device.store.nr_resident = 0;
+	asgn1_device.generation++;
+
+	schedule_work(&asgn1_device.reclaim_work);
+	return 0;
+}
+
+
+/**
+* Discard the byte range [start, start + len), the pages dropped from the
+* store are handed to the reclaim worker. Like a wipe this is refused while
+* the device is mapped. Caller must hold asgn1_device.lock.
+*/
+int discard_range(loff_t start, loff_t len) {
+	LIST_HEAD(freed);
+	int result;
+
+	if(atomic_read(&asgn1_device.mmaps) > 0){
+		return -EBUSY;
+	}
+
+	result = store_discard(&asgn1_device.store, start, len, &freed);
+
+	/* Pages may have been dropped before an evicted page failed to load. */
+	if(!list_empty(&freed)){
+		spin_lock(&asgn1_device.reclaim_lock);
+		list_splice_tail_init(&freed, &asgn1_device.reclaim_pages);
+		spin_unlock(&asgn1_device.reclaim_lock);
+		schedule_work(&asgn1_device.reclaim_work);
+	}
+
+	if(result < 0){
+		return result;
+	}
+
+	printk(KERN_INFO "Discarded %d pages\n", result);
+	return 0;
+}
+
+
+/**
+* Read page page_no back from the backing file into node. Caller must hold
+* asgn1_device.lock.
+*/
+static int load_page(page_node *node, long page_no) {
+	loff_t pos = (loff_t) page_no << PAGE_SHIFT;
+	struct page *page;
+	ssize_t result;
+
+	page = alloc_page(GFP_KERNEL);
+	if(page == NULL){
+		return -ENOMEM;
+	}
+
+	result = kernel_read(asgn1_device.backing, page_address(page), PAGE_SIZE, &pos);
+	if(result != PAGE_SIZE){
+		printk(KERN_WARNING "%s: failed to read page %ld from the backing file\n", MYDEV_NAME, page_no);
+		__free_page(page);
+		return result < 0 ? result : -EIO;
+	}
+
+	node->page = page;
+	node->dirty = false;
+	asgn1_device.store.nr_resident++;
+	asgn1_device.swapins++;
+	return 0;
+}
+
+
+/**
+* Store fault hook, brings an evicted page back in along with up to
+* READAHEAD_PAGES evicted pages following it. Readahead pages are left
+* unreferenced so the clock takes them first if they go unused.
+*/
+static int fault_page(asgn1_store *store, page_node *node, long page_no) {
+	page_node *next = node;
+	int result;
+	int i;
+
+	result = load_page(node, page_no);
+	if(result != 0){
+		return result;
+	}
+
+	for(i = 1; i <= READAHEAD_PAGES; i++){
+		if(next->list.next == &store->mem_list){
+			break;
+		}
+		next = list_next_entry(next, list);
+		if(next->page != NULL || !next->on_disk || load_page(next, page_no + i) != 0){
+			break;
+		}
+		next->referenced = false;
+	}
+
+	if(ram_pages > 0 && store->nr_resident > ram_pages){
+		schedule_work(&asgn1_device.evict_work);
+	}
+	return 0;
+}
+
+
+/**
+* Background evictor, a clock scan over the page list which keeps the number
+* of resident pages at ram_pages. Referenced pages get a second chance; clean
+* pages that the backing file already holds are dropped straight away, dirty
+* ones are written back in batches with the lock released. A page written to
+* again during writeback, or still being written, stays in memory. Mapped pages are pinned by
+* remap_pfn_range, so nothing is evicted while the device is mapped.
+*
+* A failed write ends the pass, the page stays dirty in memory and the next
+* writer over budget schedules another try. After an allocation failure
+* make_room asks for evict_reserve pages more, even without a budget. A work
+* item never runs concurrently with itself, so the batch lives in
+* asgn1_device.
+*/
+static void evict_worker(struct work_struct *work) {
+	struct evict_victim *victims = asgn1_device.evict_batch;
+	asgn1_store *store = &asgn1_device.store;
+	unsigned long scanned;
+	unsigned long gen;
+	unsigned long dropped;
+	unsigned long target = ram_pages > 0 ? ram_pages : ULONG_MAX;
+	page_node *node;
+	loff_t pos;
+	ssize_t result;
+	int failed;
+	int n;
+	int i;
+
+	for(;;){
+		n = 0;
+		dropped = 0;
+
+		mutex_lock(&asgn1_device.lock);
+		if(asgn1_device.evict_reserve > 0){
+			target = min(target, store->nr_resident -
+			min(store->nr_resident, asgn1_device.evict_reserve));
+			asgn1_device.evict_reserve = 0;
+		}
+		if(asgn1_device.backing == NULL || store->nr_resident <= target ||
+			atomic_read(&asgn1_device.mmaps) > 0){
+			mutex_unlock(&asgn1_device.lock);
+			return;
+		}
+
+		if(asgn1_device.clock_hand == NULL || asgn1_device.clock_gen != asgn1_device.generation){
+			asgn1_device.clock_hand = list_first_entry(&store->mem_list, page_node, list);
+			asgn1_device.clock_gen = asgn1_device.generation;
+			asgn1_device.clock_page_no = 0;
+		}
+
+		/* Two sweeps are enough to find a page without a second chance. */
+		for(scanned = 0; scanned < 2 * store->num_pages && n < EVICT_BATCH &&
+			store->nr_resident - n > target; scanned++){
+
+			if(&asgn1_device.clock_hand->list == &store->mem_list){
+				asgn1_device.clock_hand = list_first_entry(&store->mem_list, page_node, list);
+				asgn1_device.clock_page_no = 0;
+			}
+			node = asgn1_device.clock_hand;
+			asgn1_device.clock_hand = list_next_entry(node, list);
+			asgn1_device.clock_page_no++;
+
+			/* Pages being written with the lock dropped stay where they are. */
+			if(node->page == NULL || node->writers > 0){
+				continue;
+			}
+			if(node->referenced){
+				node->referenced = false;
+				continue;
+			}
+
+			if(!node->dirty && node->on_disk){
+				__free_page(node->page);
+				node->page = NULL;
+				store->nr_resident--;
+				asgn1_device.evictions++;
+				dropped++;
+				continue;
+			}
+
+			get_page(node->page);
+			node->dirty = false;
+			victims[n].node = node;
+			victims[n].page = node->page;
+			victims[n].page_no = asgn1_device.clock_page_no - 1;
+			n++;
+		}
+		gen = asgn1_device.generation;
+		mutex_unlock(&asgn1_device.lock);
+
+		if(n == 0 && dropped == 0){
+			return;
+		}
+
+		failed = 0;
+		for(i = 0; i < n; i++){
+			pos = (loff_t) victims[i].page_no << PAGE_SHIFT;
+			result = kernel_write(asgn1_device.backing,
+			page_address(victims[i].page), PAGE_SIZE, &pos);
+			victims[i].written = result == PAGE_SIZE;
+			if(!victims[i].written && failed++ == 0){
+				printk(KERN_WARNING "%s: failed to write page %ld to the backing file: %zd\n",
+				MYDEV_NAME, victims[i].page_no, result);
+			}
+		}
+
+		mutex_lock(&asgn1_device.lock);
+		asgn1_device.writeback_errors += failed;
+		asgn1_device.evict_failed = failed != 0;
+		for(i = 0; i < n; i++){
+			node = victims[i].node;
+
+			/* Nodes of an older generation may already be freed, leave them alone. */
+			if(gen == asgn1_device.generation && node->page == victims[i].page){
+				if(victims[i].written && !node->dirty && node->writers == 0 &&
+					atomic_read(&asgn1_device.mmaps) == 0){
+					node->page = NULL;
+					node->on_disk = true;
+					store->nr_resident--;
+					asgn1_device.evictions++;
+					put_page(victims[i].page);
+				} else {
+					node->dirty = true;
+				}
+			}
+			put_page(victims[i].page);
+		}
+		mutex_unlock(&asgn1_device.lock);
+
+		if(failed != 0){
+			return;
+		}
+
+		cond_resched();
+	}
+}
+
+
+/**
+* Background scrubber, verifies up to scrub_rate pages per second and seals
+* pages left unsealed by full page writes, or by writable mappings once those
+* are gone.
+* Page nodes are only freed by a wipe, so the cursor stays valid for as long
+* as the generation it was taken in.
+*/
+static int scrub_thread(void *data) {
+	page_node *cursor = NULL;    /* next page node to verify */
+	unsigned long cursor_gen = 0; /* generation the cursor belongs to */
+	long page_no = 0;            /* page number of the cursor */
+	unsigned int batch;
+	unsigned int n;
+
+	while(!kthread_should_stop()){
+		batch = max(1U, scrub_rate * SCRUB_INTERVAL_MS / 1000);
+
+		mutex_lock(&asgn1_device.lock);
+
+		if(cursor == NULL || cursor_gen != asgn1_device.generation){
+			cursor = list_first_entry(&asgn1_device.store.mem_list, page_node, list);
+			cursor_gen = asgn1_device.generation;
+			page_no = 0;
+		}
+
+		for(n = 0; n < batch && &cursor->list != &asgn1_device.store.mem_list; n++){
+			/* Pages being written are left alone until the write is done. */
+			if(cursor->page != NULL && cursor->writers == 0){
+				if(!cursor->sealed){
+					seal_page(cursor);
+				} else {
+					verify_page(cursor, page_no);
+				}
+				asgn1_device.scrubbed_pages++;
+			}
+			cursor = list_next_entry(cursor, list);
+			page_no++;
+		}
+
+		/* End of the list, start over on the next pass. */
+		if(&cursor->list == &asgn1_device.store.mem_list){
+			cursor = NULL;
+		}
+
+		mutex_unlock(&asgn1_device.lock);
+
+		msleep_interruptible(SCRUB_INTERVAL_MS);
+	}
+	return 0;
+}
+
+
+/**
+* Keep the number of resident pages near ram_pages while a read or write
+* brings pages in, called between runs without the lock. Past the budget the
+* evictor is started; well past it the caller waits for it, unless its
+* writes are failing.
+*/
+static void enforce_budget(void) {
+	if(asgn1_device.backing && ram_pages > 0 && asgn1_device.store.nr_resident > ram_pages){
+		schedule_work(&asgn1_device.evict_work);
+		if(asgn1_device.store.nr_resident > ram_pages + ram_pages / 4 &&
+			!asgn1_device.evict_failed){
+			flush_work(&asgn1_device.evict_work);
+		}
+	}
+}
+
+
+/**
+* An allocation failed: have the evictor free EVICT_BATCH pages, below
+* ram_pages if need be, and wait for it. Returns whether it is worth trying
+* the allocation again. Called without the lock.
+*/
+static bool make_room(void) {
+	if(asgn1_device.backing == NULL){
+		return false;
+	}
+
+	mutex_lock(&asgn1_device.lock);
+	asgn1_device.evict_reserve = EVICT_BATCH;
+	mutex_unlock(&asgn1_device.lock);
+
+	schedule_work(&asgn1_device.evict_work);
+	flush_work(&asgn1_device.evict_work);
+	return !asgn1_device.evict_failed;
+}
+
+
+/**
+* This function opens the virtual disk, if it is opened in the write-only
+* mode, all memory pages will be freed.
+*/
+int asgn1_open(struct inode *inode, struct file *filp) {
+	int result;
+
+	/* Increment process count, if exceeds max_nprocs, return -EBUSY */
+	if(atomic_read(&asgn1_device.nprocs) >= atomic_read(&asgn1_device.max_nprocs)){
+		return -EBUSY;
+	} else {
+		atomic_inc(&asgn1_device.nprocs);
+	}
+
+	/* If opened in write-only mode, wipe the disk, pages are freed in the background */
+	//if(filp->f_mode == FMODE_WRITE){
+	if(filp->f_flags & O_WRONLY){
+		printk(KERN_INFO "Write only mode, wiping all pages.\n");
+		mutex_lock(&asgn1_device.lock);
+		result = wipe_memory_pages();
+		mutex_unlock(&asgn1_device.lock);
+		if(result != 0){
+			printk(KERN_WARNING "Device is mapped, not wiping");
+			atomic_dec(&asgn1_device.nprocs);
+			return result;
+		}
+	}
+	printk(KERN_INFO "Device Succesfully Opened\n");
+	return 0; /* Success */
+}
+
+
+/**
+* This function releases the virtual disk, but nothing needs to be done in this case.
+*/
+int asgn1_release (struct inode *inode, struct file *filp) {
+
+	/* Decrement process count */
+	atomic_dec(&asgn1_device.nprocs);
+
+	printk(KERN_INFO "Successfuly Released, Current NPROCS: %d\n", atomic_read(&asgn1_device.nprocs));
+	return 0;
+}
+
+
+/**
+* This function reads contents of the virtual disk and writes to the user 
+*
+* The lock is never held across a user copy: a fault on buf takes mmap_sem,
+* which asgn1_mmap already holds when it takes the lock. Each run of pages is
+* pinned under the lock and copied without it.
+*/
+ssize_t asgn1_read(struct file *filp, char __user *buf, size_t count,
+loff_t *f_pos) {
+	size_t size_read = 0;
+	unsigned long not_copied;
+	unsigned long gen;
+	struct store_run run;
+	bool retried = false;
+	int result = 0;
+
+	printk(KERN_WARNING "Entering Read Function");
+
+	while(size_read < count){
+		if(mutex_lock_interruptible(&asgn1_device.lock)){
+			result = -ERESTARTSYS;
+			break;
+		}
+		gen = asgn1_device.generation;
+		result = store_get_run(&asgn1_device.store, *f_pos, count - size_read, false, &run);
+		mutex_unlock(&asgn1_device.lock);
+		if(result == -ENOMEM && !retried && make_room()){
+			retried = true;
+			continue;
+		}
+		if(result != 0 || run.len == 0){
+			break;
+		}
+		retried = false;
+
+		if(run.page == NULL){
+			not_copied = clear_user(buf + size_read, run.len);
+		} else {
+			not_copied = copy_to_user(buf + size_read,
+			page_address(run.page) + run.offset, run.len);
+		}
+
+		mutex_lock(&asgn1_device.lock);
+		store_put_run(&asgn1_device.store, &run, run.len - not_copied,
+		gen == asgn1_device.generation);
+		mutex_unlock(&asgn1_device.lock);
+
+		size_read += run.len - not_copied;
+		*f_pos += run.len - not_copied;
+		if(not_copied != 0){
+			result = -EFAULT;
+			break;
+		}
+
+		/* Pages faulted back in count against the budget too. */
+		enforce_budget();
+	}
+
+	printk(KERN_WARNING "Read %d bytes\n", (int)size_read);
+	if(size_read == 0 && result != 0){
+		return result;
+	}
+	return size_read;
+}
+
+static loff_t asgn1_lseek (struct file *file, loff_t offset, int cmd)
+{
+	loff_t testpos;
+
+	mutex_lock(&asgn1_device.lock);
+	testpos = store_seek(&asgn1_device.store, file->f_pos, offset, cmd);
+	mutex_unlock(&asgn1_device.lock);
+
+	/* set file->f_pos to testpos */
+	file->f_pos = testpos;
+
+	printk (KERN_INFO "Seeking to pos=%ld\n", (long)testpos);
+	return testpos;
+}
+
+
+/**
+* This function writes from the user buffer to the virtual disk of this
+* module, run by run with the lock dropped around the copies like asgn1_read.
+* With a backing file the number of resident pages is kept in check between
+* runs, and an allocation failure evicts pages and tries again before the
+* write fails.
+*/
+ssize_t asgn1_write(struct file *filp, const char __user *buf, size_t count,
+loff_t *f_pos) {
+	size_t size_written = 0;
+	unsigned long not_copied;
+	unsigned long gen;
+	struct store_run run;
+	bool retried = false;
+	int result = 0;
+
+	printk(KERN_INFO "Entered Write Function");
+
+	while(size_written < count){
+		if(mutex_lock_interruptible(&asgn1_device.lock)){
+			result = -ERESTARTSYS;
+			break;
+		}
+		gen = asgn1_device.generation;
+		result = store_get_run(&asgn1_device.store, *f_pos, count - size_written, true, &run);
+		mutex_unlock(&asgn1_device.lock);
+		if(result == -ENOMEM && !retried && make_room()){
+			retried = true;
+			continue;
+		}
+		if(result != 0 || run.len == 0){
+			break;
+		}
+		retried = false;
+
+		not_copied = copy_from_user(page_address(run.page) + run.offset,
+		buf + size_written, run.len);
+
+		mutex_lock(&asgn1_device.lock);
+		store_put_run(&asgn1_device.store, &run, run.len - not_copied,
+		gen == asgn1_device.generation);
+		mutex_unlock(&asgn1_device.lock);
+
+		size_written += run.len - not_copied;
+		*f_pos += run.len - not_copied;
+		if(not_copied != 0){
+			result = -EFAULT;
+			break;
+		}
+
+		/* Each run backs at most one block, keep the total within budget. */
+		enforce_budget();
+	}
+
+	printk(KERN_WARNING "Wrote %d bytes\n", (int)size_written);
+	if(size_written == 0 && result != 0){
+		return result;
+	}
+	return size_written;
+}
+
+#define SET_NPROC_OP 1
+#define TEM_SET_NPROC _IOW(MYIOC_TYPE, SET_NPROC_OP, int) 
+#define DISCARD_OP 2
+#define TEM_DISCARD _IOW(MYIOC_TYPE, DISCARD_OP, struct asgn1_range)
+
+/**
+* Byte range passed to the DISCARD_OP ioctl, same layout as BLKDISCARD.
+*/
+struct asgn1_range {
+	__u64 start;
+	__u64 len;
+};
+
+/**
+* The ioctl function, which nothing needs to be done in this case.
+*/
+long asgn1_ioctl (struct file *filp, unsigned cmd, unsigned long arg) {
+	int nr;
+	int new_nprocs;
+	int result;
+	struct asgn1_range range;
+
+	printk(KERN_INFO "Entering IOCTL Function");
+
+	/* check whether cmd is for our device, if not for us, return -EINVAL */
+	if(MYIOC_TYPE !=  _IOC_TYPE(cmd)){
+		printk(KERN_WARNING "Command not for asgn1_device, returning");
+		return -EINVAL;
+	}
+
+	/* get command, if command is SET_NPROC_OP, then get the data, and set max_nprocs accordingly. */
+	nr = _IOC_NR(cmd);
+	if( nr == SET_NPROC_OP){
+
+		/*check validity of the value before setting max_nprocs*/
+		if( access_ok(VERIFY_READ, arg, sizeof(cmd))){
+
+			result = __get_user(new_nprocs, (int*) arg);
+			if( result != 0 ){ /* Bad Access from User Space. */
+				printk(KERN_WARNING "Bad Access from User Space\n");
+				return -EFAULT;
+			}
+
+			if( new_nprocs < 1 ){ /* Max nprocs must be at least one. */
+				printk(KERN_WARNING "New max nprocs less than one");
+				return -EINVAL;
+			}
+
+			atomic_set(&asgn1_device.max_nprocs, new_nprocs); /* Update max_nprocs. */
+			printk(KERN_INFO "Max nprocs update successful");
+			return 0; /* Success. */
+
+		} else {
+			printk(KERN_WARNING "access_ok() failed, unallowed access");
+			return -EFAULT; /* Access not allowed. */
+		}
+
+	}
+
+	/* DISCARD_OP drops the given byte range, pages are freed in the background. */
+	if( nr == DISCARD_OP){
+		/* Discarding destroys data, so like BLKDISCARD it needs a writable fd. */
+		if(!(filp->f_mode & FMODE_WRITE)){
+			return -EBADF;
+		}
+		if(_IOC_SIZE(cmd) != sizeof(range)){
+			return -EINVAL;
+		}
+
+		if(copy_from_user(&range, (void __user *) arg, sizeof(range))){
+			printk(KERN_WARNING "Bad Access from User Space\n");
+			return -EFAULT;
+		}
+
+		if(range.start > LLONG_MAX || range.len > LLONG_MAX){
+			return -EINVAL;
+		}
+
+		if(mutex_lock_interruptible(&asgn1_device.lock)){
+			return -ERESTARTSYS;
+		}
+		result = discard_range(range.start, range.len);
+		mutex_unlock(&asgn1_device.lock);
+		return result;
+	}
+
+	printk(KERN_WARNING "Bad command for driver");
+	return -ENOTTY; /* Command not applicable to this driver */
+
+}
+
+
+/**
+* Mappings are counted so pages are not evicted while mapped, and writable
+* shared ones so pages are not resealed while user space can still modify
+* them directly.
+*/
+static bool vma_writable(struct vm_area_struct *vma)
+{
+	return (vma->vm_flags & VM_SHARED) && (vma->vm_flags & VM_MAYWRITE);
+}
+
+static void asgn1_vma_open(struct vm_area_struct *vma)
+{
+	atomic_inc(&asgn1_device.mmaps);
+	if(vma_writable(vma)){
+		atomic_inc(&asgn1_device.mmap_writers);
+	}
+}
+
+static void asgn1_vma_close(struct vm_area_struct *vma)
+{
+	atomic_dec(&asgn1_device.mmaps);
+	if(vma_writable(vma)){
+		atomic_dec(&asgn1_device.mmap_writers);
+	}
+}
+
+static struct vm_operations_struct asgn1_vm_ops = {
+	.open = asgn1_vma_open,
+	.close = asgn1_vma_close,
+};
+
+
+static int asgn1_mmap (struct file *filp, struct vm_area_struct *vma)
+{
+	bool writable = vma_writable(vma);
+	unsigned long offset = vma->vm_pgoff;   /* first page to map */
+	unsigned long len = vma->vm_end - vma->vm_start;
+	unsigned long npages = len >> PAGE_SHIFT;
+	unsigned long run_pfn = 0;   /* first pfn of the current contiguous run */
+	unsigned long run_start = 0; /* page in the vma the run is mapped at */
+	unsigned long run_len = 0;   /* pages in the current run */
+	unsigned long pfn;
+	page_node *curr;
+	unsigned long index = 0;
+	int result = 0;
+
+	mutex_lock(&asgn1_device.lock);
+
+	/* Check offset and len */
+	if(offset > asgn1_device.store.num_pages || npages > asgn1_device.store.num_pages - offset){
+		printk(KERN_WARNING "Mapping beyond the ramdisk size");
+		result = -EINVAL;
+		goto out;
+	}
+
+	/* loop through the page list, mapping each physically contiguous run of pages at once */
+	list_for_each_entry(curr, &asgn1_device.store.mem_list, list){
+		if(index >= offset + npages){
+			break;
+		}
+
+		if(index >= offset){
+			/* Discarded pages have to be backed again and evicted ones brought back. */
+			result = store_load(&asgn1_device.store, curr, index, true);
+			if(result != 0){
+				goto out;
+			}
+			curr->referenced = true;
+
+			/* The mapping can now change the page behind the checksum and the backing file. */
+			if(writable){
+				curr->sealed = false;
+				curr->dirty = true;
+			}
+
+			pfn = page_to_pfn(curr->page);
+			if(run_len > 0 && pfn == run_pfn + run_len){
+				run_len++;
+			} else {
+				if(run_len > 0){
+					result = remap_pfn_range(vma, vma->vm_start + (run_start << PAGE_SHIFT),
+					run_pfn, run_len << PAGE_SHIFT, vma->vm_page_prot);
+					if(result != 0){
+						goto out;
+					}
+				}
+				run_pfn = pfn;
+				run_start = index - offset;
+				run_len = 1;
+			}
+		}
+		index++;
+	}
+
+	if(run_len > 0){
+		result = remap_pfn_range(vma, vma->vm_start + (run_start << PAGE_SHIFT),
+		run_pfn, run_len << PAGE_SHIFT, vma->vm_page_prot);
+		if(result != 0){
+			goto out;
+		}
+	}
+
+	vma->vm_ops = &asgn1_vm_ops;
+	asgn1_vma_open(vma);
+
+out:
+	mutex_unlock(&asgn1_device.lock);
+	return result;
+}
+
+
+struct file_operations asgn1_fops = {
+	.owner = THIS_MODULE,
+	.read = asgn1_read,
+	.write = asgn1_write,
+	.unlocked_ioctl = asgn1_ioctl,
+	.open = asgn1_open,
+	.mmap = asgn1_mmap,
+	.release = asgn1_release,
+	.llseek = asgn1_lseek
+};
+
+
+static void *my_seq_start(struct seq_file *s, loff_t *pos)
+{
+	if(*pos >= 1) return NULL;
+	else return &asgn1_dev_count + *pos;
+}
+
+static void *my_seq_next(struct seq_file *s, void *v, loff_t *pos)
+{
+	(*pos)++;
+	if(*pos >= 1) return NULL;
+	else return &asgn1_dev_count + *pos;
+}
+
+static void my_seq_stop(struct seq_file *s, void *v)
+{
+	/* There's nothing to do here! */
+}
+
+int my_seq_show(struct seq_file *s, void *v) {
+	/**
+* use seq_printf to print some info to s
+*/
+	seq_printf(s,"Major Number: %d\n Minor Number: %d\n Num Pages: %lu\n Data Size: %zu\n Nprocs: %d\n Max-Nprocs: %d\n Generation: %lu\n",
+	asgn1_major, asgn1_minor, asgn1_device.store.num_pages, asgn1_device.store.data_size,
+	atomic_read(&asgn1_device.nprocs), atomic_read(&asgn1_device.max_nprocs),
+	asgn1_device.generation);
+	if(integrity){
+		seq_printf(s," Checksum Errors: %lu\n Last Bad Page: %ld\n Scrubbed Pages: %lu\n",
+		asgn1_device.csum_errors, asgn1_device.last_bad_page,
+		asgn1_device.scrubbed_pages);
+	}
+	if(asgn1_device.backing){
+		seq_printf(s," Resident Pages: %lu\n Evictions: %lu\n Swap-ins: %lu\n Writeback Errors: %lu\n",
+		asgn1_device.store.nr_resident, asgn1_device.evictions,
+		asgn1_device.swapins, asgn1_device.writeback_errors);
+	}
+	return 0;
+
+
+}
+
+
+static struct seq_operations my_seq_ops = {
+	.start = my_seq_start,
+	.next = my_seq_next,
+	.stop = my_seq_stop,
+	.show = my_seq_show
+};
+
+static int my_proc_open(struct inode *inode, struct file *filp)
+{
+	return seq_open(filp, &my_seq_ops);
+}
+
+struct file_operations asgn1_proc_ops = {
+	.owner = THIS_MODULE,
+	.open = my_proc_open,
+	.llseek = seq_lseek,
+	.read = seq_read,
+	.release = seq_release,
+};
+
+
+
+/**
+* Initialise the module and create the master device
+*/
+int __init asgn1_init_module(void){
+	int result;
+	unsigned long i;
+	
+	/* set nprocs and max_nprocs of the device */
+	atomic_set(&asgn1_device.nprocs, 0);
+	atomic_set(&asgn1_device.max_nprocs, 1);
+
+	/* Allocate Major/Minor number */
+	asgn1_device.dev = MKDEV(asgn1_major, asgn1_minor);
+	result = alloc_chrdev_region(&asgn1_device.dev, asgn1_minor, asgn1_dev_count, MYDEV_NAME);
+	if(result != 0){
+		printk(KERN_WARNING "Major/Minor number allocation failed");
+		goto fail_device;
+	}
+
+	/* Initialise page list */
+	store_init(&asgn1_device.store);
+	asgn1_device.store.verify = verify_page;
+	asgn1_device.store.update = update_csum;
+	mutex_init(&asgn1_device.lock);
+
+	/* Initialise background reclaim */
+	spin_lock_init(&asgn1_device.reclaim_lock);
+	INIT_LIST_HEAD(&asgn1_device.reclaim_nodes);
+	INIT_LIST_HEAD(&asgn1_device.reclaim_pages);
+	INIT_WORK(&asgn1_device.reclaim_work, reclaim_worker);
+
+	/* Open the backing file for evicted pages */
+	INIT_WORK(&asgn1_device.evict_work, evict_worker);
+	atomic_set(&asgn1_device.mmaps, 0);
+	if(backing_file){
+		asgn1_device.backing = filp_open(backing_file, O_RDWR | O_CREAT | O_LARGEFILE, 0600);
+		if(IS_ERR(asgn1_device.backing)){
+			printk(KERN_WARNING "Failed to open backing file %s", backing_file);
+			result = PTR_ERR(asgn1_device.backing);
+			asgn1_device.backing = NULL;
+			goto fail_device;
+		}
+		asgn1_device.store.fault = fault_page;
+	}
+
+	/* Start the checksum scrubber */
+	atomic_set(&asgn1_device.mmap_writers, 0);
+	asgn1_device.last_bad_page = -1;
+	csum_shift[0] = 1U << 31;
+	for(i = 1; i < PAGE_SIZE; i++){
+		csum_shift[i] = __crc32c_le_shift(csum_shift[i - 1], 1);
+	}
+	if(integrity){
+		asgn1_device.scrubber = kthread_run(scrub_thread, NULL, "%s_scrub", MYDEV_NAME);
+		if(IS_ERR(asgn1_device.scrubber)){
+			printk(KERN_WARNING "Failed to start the scrubber");
+			result = PTR_ERR(asgn1_device.scrubber);
+			asgn1_device.scrubber = NULL;
+			goto fail_device;
+		}
+	}
+
+	/* Allocate cdev and set ops and owner field, the device is live once
+	   cdev_add returns so everything it uses is set up above. */
+	asgn1_device.cdev = cdev_alloc();
+	cdev_init(asgn1_device.cdev, &asgn1_fops);
+	asgn1_device.cdev->owner = THIS_MODULE; 
+	result = cdev_add(asgn1_device.cdev, asgn1_device.dev, asgn1_dev_count);
+	if(result != 0){
+		printk(KERN_WARNING "CDEV Initialisation Failed");
+		goto fail_device;
+	}
+
+	/* Create proc entries */
+	asgn1_proc = proc_create(MYDEV_NAME, 0, NULL, &asgn1_proc_ops);
+	
+	asgn1_device.class = class_create(THIS_MODULE, MYDEV_NAME);
+	if (IS_ERR(asgn1_device.class)) {
+	}
+
+	asgn1_device.device = device_create(asgn1_device.class, NULL, 
+	asgn1_device.dev, "%s", MYDEV_NAME);
+	if (IS_ERR(asgn1_device.device)) {
+		printk(KERN_WARNING "%s: can't create udev device\n", MYDEV_NAME);
+		result = -ENOMEM;
+		goto fail_device;
+	}
+
+	printk(KERN_WARNING "set up udev entry\n");
+	printk(KERN_WARNING "Hello world from %s\n", MYDEV_NAME);
+	return 0;
+
+	/* cleanup code called when any of the initialization steps fail */
+	fail_device:
+	class_destroy(asgn1_device.class);
+	
+	if(asgn1_proc) remove_proc_entry(MYDEV_NAME, NULL);
+	if(asgn1_device.cdev) cdev_del(asgn1_device.cdev);
+	if(asgn1_device.scrubber) kthread_stop(asgn1_device.scrubber);
+	if(asgn1_device.backing) filp_close(asgn1_device.backing, NULL);
+	unregister_chrdev_region(asgn1_device.dev, asgn1_dev_count);
+
+	return result;
+}
+
+
+/**
+* Finalise the module
+*/
+void __exit asgn1_exit_module(void){
+	device_destroy(asgn1_device.class, asgn1_device.dev);
+	class_destroy(asgn1_device.class);
+	printk(KERN_WARNING "cleaned up udev entry\n");
+
+	/**
+	* free all pages in the page list
+	* cleanup in reverse order
+	*/
+	if(asgn1_device.scrubber) kthread_stop(asgn1_device.scrubber);
+	cancel_work_sync(&asgn1_device.evict_work);
+	flush_work(&asgn1_device.reclaim_work);
+	free_memory_pages();
+	if(asgn1_device.backing) filp_close(asgn1_device.backing, NULL);
+
+	remove_proc_entry(MYDEV_NAME, NULL);
+	cdev_del(asgn1_device.cdev);
+	unregister_chrdev_region(asgn1_device.dev, asgn1_dev_count);
+	printk(KERN_WARNING "Good bye from %s\n", MYDEV_NAME);
+}
+
+
+module_init(asgn1_init_module);
+module_exit(asgn1_exit_module);
+
+
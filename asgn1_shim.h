@@ -0,0 +1,400 @@
+/**
+* File: asgn1_shim.h
+*
+* The small set of kernel interfaces used by the page store core and its
+* checksum hooks. Inside the kernel these come straight from the kernel
+* headers, in userspace they are emulated on top of libc so the core can be
+* unit tested and profiled without loading the module.
+*/
+
+/* This program is free software; you can redistribute it and/or
+* modify it under the terms of the GNU General Public License
+* as published by the Free Software Foundation; either version
+* 2 of the License, or (at your option) any later version.
+*/
+
+#ifndef ASGN1_SHIM_H
+#define ASGN1_SHIM_H
+
+#ifdef __KERNEL__
+
+#include <linux/kernel.h>
+#include <linux/types.h>
+#include <linux/list.h>
+#include <linux/mm.h>
+#include <linux/fs.h>
+#include <linux/slab.h>
+#include <linux/crc32.h>
+#include <linux/crc32c.h>
+#include <asm/uaccess.h>
+
+#else /* userspace */
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <errno.h>
+#include <limits.h>
+#include <stddef.h>
+#include <sys/types.h>
+#include <unistd.h>
+#include <sys/mman.h>
+
+#define __user
+#define KERN_INFO ""
+#define KERN_WARNING ""
+#define KERN_ERR ""
+#define printk(...) do { } while (0)
+
+typedef uint32_t u32;
+
+#define PAGE_SHIFT 12
+#define PAGE_SIZE (1UL << PAGE_SHIFT)
+
+#define GFP_KERNEL 0
+#define __GFP_ZERO 1
+#define __GFP_NOWARN 0
+#define __GFP_NORETRY 0
+
+/* Fill for pages allocated without __GFP_ZERO, stands in for stale memory. */
+#define PAGE_POISON 0x5a
+
+#define min(x, y) ({ typeof(x) _x = (x); typeof(y) _y = (y); _x < _y ? _x : _y; })
+#define max(x, y) ({ typeof(x) _x = (x); typeof(y) _y = (y); _x > _y ? _x : _y; })
+#define min_t(type, x, y) min((type)(x), (type)(y))
+
+#define container_of(ptr, type, member) \
+	((type *)((char *)(ptr) - offsetof(type, member)))
+
+/**
+* Doubly linked list, same layout and semantics as <linux/list.h>.
+*/
+struct list_head {
+	struct list_head *next, *prev;
+};
+
+#define LIST_HEAD_INIT(name) { &(name), &(name) }
+#define LIST_HEAD(name) struct list_head name = LIST_HEAD_INIT(name)
+
+static inline void INIT_LIST_HEAD(struct list_head *list)
+{
+	list->next = list;
+	list->prev = list;
+}
+
+static inline void __list_add(struct list_head *new, struct list_head *prev,
+struct list_head *next)
+{
+	next->prev = new;
+	new->next = next;
+	new->prev = prev;
+	prev->next = new;
+}
+
+static inline void list_add(struct list_head *new, struct list_head *head)
+{
+	__list_add(new, head, head->next);
+}
+
+static inline void list_add_tail(struct list_head *new, struct list_head *head)
+{
+	__list_add(new, head->prev, head);
+}
+
+static inline void list_del(struct list_head *entry)
+{
+	entry->next->prev = entry->prev;
+	entry->prev->next = entry->next;
+	entry->next = NULL;
+	entry->prev = NULL;
+}
+
+static inline void list_move(struct list_head *list, struct list_head *head)
+{
+	list->next->prev = list->prev;
+	list->prev->next = list->next;
+	list_add(list, head);
+}
+
+static inline int list_empty(const struct list_head *head)
+{
+	return head->next == head;
+}
+
+static inline void list_splice_tail_init(struct list_head *list,
+struct list_head *head)
+{
+	if (!list_empty(list)) {
+		list->next->prev = head->prev;
+		head->prev->next = list->next;
+		list->prev->next = head;
+		head->prev = list->prev;
+		INIT_LIST_HEAD(list);
+	}
+}
+
+#define list_entry(ptr, type, member) container_of(ptr, type, member)
+#define list_first_entry(ptr, type, member) list_entry((ptr)->next, type, member)
+#define list_next_entry(pos, member) \
+	list_entry((pos)->member.next, typeof(*(pos)), member)
+
+#define list_for_each_entry(pos, head, member) \
+	for (pos = list_first_entry(head, typeof(*pos), member); \
+	     &pos->member != (head); \
+	     pos = list_next_entry(pos, member))
+
+#define list_for_each_entry_safe(pos, n, head, member) \
+	for (pos = list_first_entry(head, typeof(*pos), member), \
+	     n = list_next_entry(pos, member); \
+	     &pos->member != (head); \
+	     pos = n, n = list_next_entry(n, member))
+
+/**
+* A struct page describes one page of an anonymous mapping. Blocks of
+* 1 << order pages share one mapping and one array of struct pages, which
+* is released once every page of the block has been freed. Blocks are
+* always usable page by page, so split_page has nothing to do. A page is
+* unmapped once its last reference is dropped, so touching a page that is
+* no longer pinned faults.
+*/
+struct page {
+	void *addr;
+	struct list_head lru;
+	int count;              /* references to this page */
+	struct page *block;     /* first struct page of the block */
+	unsigned long *refs;    /* pages of the block not freed yet */
+};
+
+#define nth_page(page, n) ((page) + (n))
+
+static inline void *page_address(struct page *page)
+{
+	return page->addr;
+}
+
+static inline struct page *alloc_pages(int gfp, unsigned int order)
+{
+	unsigned long n = 1UL << order;
+	unsigned long i;
+	struct page *block;
+	unsigned long *refs;
+	char *addr;
+
+	block = calloc(n, sizeof(*block));
+	refs = malloc(sizeof(*refs));
+	addr = mmap(NULL, n * PAGE_SIZE, PROT_READ | PROT_WRITE,
+	            MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (block == NULL || refs == NULL || addr == MAP_FAILED) {
+		if (addr != MAP_FAILED)
+			munmap(addr, n * PAGE_SIZE);
+		free(block);
+		free(refs);
+		return NULL;
+	}
+
+	/* Anonymous mappings are zeroed, the kernel makes no such promise. */
+	if (!(gfp & __GFP_ZERO))
+		memset(addr, PAGE_POISON, n * PAGE_SIZE);
+
+	*refs = n;
+	for (i = 0; i < n; i++) {
+		block[i].addr = addr + i * PAGE_SIZE;
+		block[i].count = 1;
+		block[i].block = block;
+		block[i].refs = refs;
+	}
+	return block;
+}
+
+static inline struct page *alloc_page(int gfp)
+{
+	return alloc_pages(gfp, 0);
+}
+
+static inline void split_page(struct page *page, unsigned int order)
+{
+	(void)page;
+	(void)order;
+}
+
+static inline void get_page(struct page *page)
+{
+	page->count++;
+}
+
+static inline void put_page(struct page *page)
+{
+	if (--page->count > 0)
+		return;
+	munmap(page->addr, PAGE_SIZE);
+	if (--*page->refs == 0) {
+		free(page->refs);
+		free(page->block);
+	}
+}
+
+static inline void __free_page(struct page *page)
+{
+	put_page(page);
+}
+
+static inline void *kmalloc(size_t size, int gfp)
+{
+	(void)gfp;
+	return malloc(size);
+}
+
+static inline void kfree(const void *ptr)
+{
+	free((void *)ptr);
+}
+
+/* User and kernel memory are the same address space here. */
+static inline unsigned long copy_to_user(void __user *to, const void *from,
+unsigned long n)
+{
+	memcpy(to, from, n);
+	return 0;
+}
+
+static inline unsigned long copy_from_user(void *to, const void __user *from,
+unsigned long n)
+{
+	memcpy(to, from, n);
+	return 0;
+}
+
+static inline unsigned long clear_user(void __user *to, unsigned long n)
+{
+	memset(to, 0, n);
+	return 0;
+}
+
+/**
+* CRC32C as in <linux/crc32c.h> and <linux/crc32.h>. crc32c() returns the raw
+* register without a final inversion, __crc32c_le_shift() appends len zero
+* bytes to the data a crc was taken over, using the same square and multiply
+* as the kernel. With SSE4.2 and PCLMUL, crc32c() runs three streams at once
+* and folds them with a carry-less multiply like crc32c-intel, so store_bench
+* sees costs close to the module's.
+*/
+#define CRC32C_POLY 0x82f63b78
+
+static inline u32 crc32c_mulx(u32 crc, unsigned int bits)
+{
+	while (bits--)
+		crc = (crc >> 1) ^ (CRC32C_POLY & -(crc & 1));
+	return crc;
+}
+
+/* a * b modulo the polynomial, both bit reflected */
+static inline u32 crc32c_gf2_multiply(u32 a, u32 b)
+{
+	u32 product = 0;
+	int i;
+
+	for (i = 31; i >= 0; i--) {
+		if (a & (1U << i))
+			product ^= b;
+		b = crc32c_mulx(b, 1);
+	}
+	return product;
+}
+
+static inline u32 __crc32c_le_shift(u32 crc, size_t len)
+{
+	u32 power = CRC32C_POLY;	/* x^32 */
+
+	crc = crc32c_mulx(crc, 8 * (len & 3));
+	for (len >>= 2; len; len >>= 1) {
+		if (len & 1)
+			crc = crc32c_gf2_multiply(crc, power);
+		power = crc32c_gf2_multiply(power, power);
+	}
+	return crc;
+}
+
+static inline u32 crc32c_sw(u32 crc, const unsigned char *p, size_t len)
+{
+	static u32 table[256];
+	static bool ready;
+	unsigned int i;
+
+	if (!ready) {
+		for (i = 0; i < 256; i++)
+			table[i] = crc32c_mulx(i, 8);
+		ready = true;
+	}
+	while (len--)
+		crc = (crc >> 8) ^ table[(crc ^ *p++) & 0xff];
+	return crc;
+}
+
+#if defined(__x86_64__)
+#include <immintrin.h>
+
+#define CRC32C_STREAM 256	/* bytes per stream of the three way loop */
+
+/* crc * x^(8 * n) where k = x^(8 * n - 33), reduced by the crc32 instruction */
+__attribute__((target("sse4.2,pclmul")))
+static inline u32 crc32c_fold(u32 crc, u32 k)
+{
+	__m128i t = _mm_clmulepi64_si128(_mm_cvtsi32_si128(crc),
+	                                 _mm_cvtsi32_si128(k), 0);
+
+	return _mm_crc32_u64(0, _mm_cvtsi128_si64(t));
+}
+
+__attribute__((target("sse4.2,pclmul")))
+static inline u32 crc32c_x86(u32 crc, const unsigned char *p, size_t len)
+{
+	static u32 k1, k2;
+	uint64_t a, b, c, v;
+	size_t i;
+
+	if (k1 == 0) {
+		k1 = crc32c_mulx(1U << 31, 8 * CRC32C_STREAM - 33);
+		k2 = crc32c_mulx(1U << 31, 16 * CRC32C_STREAM - 33);
+	}
+
+	for (; len >= 3 * CRC32C_STREAM; len -= 3 * CRC32C_STREAM) {
+		a = crc;
+		b = 0;
+		c = 0;
+		for (i = 0; i < CRC32C_STREAM; i += 8) {
+			memcpy(&v, p + i, 8);
+			a = _mm_crc32_u64(a, v);
+			memcpy(&v, p + CRC32C_STREAM + i, 8);
+			b = _mm_crc32_u64(b, v);
+			memcpy(&v, p + 2 * CRC32C_STREAM + i, 8);
+			c = _mm_crc32_u64(c, v);
+		}
+		crc = crc32c_fold(a, k2) ^ crc32c_fold(b, k1) ^ c;
+		p += 3 * CRC32C_STREAM;
+	}
+
+	a = crc;
+	for (; len >= 8; len -= 8, p += 8) {
+		memcpy(&v, p, 8);
+		a = _mm_crc32_u64(a, v);
+	}
+	crc = a;
+	while (len--)
+		crc = _mm_crc32_u8(crc, *p++);
+	return crc;
+}
+#endif
+
+static inline u32 crc32c(u32 crc, const void *address, unsigned int length)
+{
+#if defined(__x86_64__)
+	if (__builtin_cpu_supports("sse4.2") && __builtin_cpu_supports("pclmul"))
+		return crc32c_x86(crc, address, length);
+#endif
+	return crc32c_sw(crc, address, length);
+}
+
+#endif /* __KERNEL__ */
+
+#endif /* ASGN1_SHIM_H */
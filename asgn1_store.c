@@ -0,0 +1,623 @@
+/**
+* File: asgn1_store.c
+* Author: Patrick Skinner
+*
+* Page store for the asgn1 virtual ramdisk, see asgn1_store.h.
+*/
+
+/* This program is free software; you can redistribute it and/or
+* modify it under the terms of the GNU General Public License
+* as published by the Free Software Foundation; either version
+* 2 of the License, or (at your option) any later version.
+*/
+
+#include "asgn1_store.h"
+
+
+/**
+* Initialise an empty store with no checksum hooks.
+*/
+void store_init(asgn1_store *store) {
+	INIT_LIST_HEAD(&store->mem_list);
+	store->num_pages = 0;
+	store->data_size = 0;
+	store->nr_resident = 0;
+	store->verify = NULL;
+	store->update = NULL;
+	store->fault = NULL;
+}
+
+
+/**
+* This function frees every page node on the given list along with its page.
+*/
+void store_free_nodes(struct list_head *nodes) {
+	page_node *curr; /* pointer to list head object */
+	page_node *temp; /* temporary list head for safe deletion */
+
+	/*Loop through the entire page list*/
+	list_for_each_entry_safe(curr, temp, nodes, list){
+
+		/* If node has a page, free the page. */
+		if(curr->page != NULL){
+			__free_page(curr->page);
+		}
+
+		/* Remove node from page list, free the node. */
+		list_del(&curr->list);
+		kfree(curr);
+	}
+}
+
+
+/**
+* Add nodes to the end of the store until it holds at least npages. The new
+* nodes are holes, pages are only allocated once data is written to them, so
+* a write far past the end costs no memory for the gap.
+*/
+int store_grow(asgn1_store *store, unsigned long npages) {
+	page_node *curr;
+
+	while(store->num_pages < npages){
+		curr = kmalloc(sizeof(page_node), GFP_KERNEL);
+		if(curr == NULL){
+			printk(KERN_INFO "Memory Allocation Failed");
+			return -ENOMEM;
+		}
+
+		curr->page = NULL;
+		curr->sealed = false;
+		curr->corrupt = false;
+		curr->referenced = false;
+		curr->dirty = false;
+		curr->on_disk = false;
+		curr->writers = 0;
+		list_add_tail( &(curr->list), &store->mem_list);
+		store->num_pages++;
+	}
+
+	return 0;
+}
+
+
+/**
+* Back up to npages consecutive holes starting at node with new pages.
+* Pages are allocated in physically contiguous blocks of up to
+* 1 << STORE_MAX_ORDER pages, falling back to smaller blocks when memory is
+* fragmented, and each block is split so its pages can still be freed one at
+* a time. Pages are zeroed, a partial write leaves the rest of the page to be
+* read back and it must not show what the page held before. Returns the
+* number of pages backed or -ENOMEM.
+*/
+static long store_fill(asgn1_store *store, page_node *node, unsigned long npages) {
+	struct page *block;
+	unsigned int order = 0;
+	unsigned long holes = 0;
+	unsigned long i;
+	page_node *curr;
+
+	/* Only fill as far as the holes go, and never more than is needed. */
+	for(curr = node; holes < min(npages, 1UL << STORE_MAX_ORDER); curr = list_next_entry(curr, list)){
+		if(curr->page != NULL || curr->on_disk){
+			break;
+		}
+		holes++;
+		if(curr->list.next == &store->mem_list){
+			break;
+		}
+	}
+	while((2UL << order) <= holes){
+		order++;
+	}
+
+	for(;;){
+		if(order > 0){
+			block = alloc_pages(GFP_KERNEL | __GFP_ZERO | __GFP_NOWARN | __GFP_NORETRY,
+			order);
+			if(block == NULL){
+				order--;
+				continue;
+			}
+			split_page(block, order);
+		} else {
+			block = alloc_page(GFP_KERNEL | __GFP_ZERO);
+			if(block == NULL){
+				printk(KERN_INFO "Memory Allocation Failed");
+				return -ENOMEM;
+			}
+		}
+		break;
+	}
+
+	curr = node;
+	for(i = 0; i < (1UL << order); i++){
+		curr->page = nth_page(block, i);
+		curr->sealed = false;
+		curr->corrupt = false;
+		curr->referenced = true;
+		curr->dirty = true;
+		store->nr_resident++;
+		curr = list_next_entry(curr, list);
+	}
+
+	return 1L << order;
+}
+
+
+/**
+* Find the node of page number page_no, or NULL if the store is smaller.
+*/
+static page_node *store_find(asgn1_store *store, unsigned long page_no) {
+	page_node *curr;
+	unsigned long curr_page_no = 0;
+
+	list_for_each_entry(curr, &store->mem_list, list){
+		if(curr_page_no == page_no){
+			return curr;
+		}
+		curr_page_no++;
+	}
+	return NULL;
+}
+
+
+/**
+* The node after curr, or NULL at the end of the store.
+*/
+static page_node *store_next(asgn1_store *store, page_node *curr) {
+	if(curr->list.next == &store->mem_list){
+		return NULL;
+	}
+	return list_next_entry(curr, list);
+}
+
+
+/**
+* Whether b directly follows a in memory, so a single copy can span both and
+* the run can be pinned through nth_page. Two holes are contiguous too, both
+* read as zeroes. Evicted pages never are, they have to be faulted in first.
+*/
+static bool pages_contiguous(page_node *a, page_node *b) {
+	if(a->page == NULL || b->page == NULL){
+		return a->page == NULL && b->page == NULL && !a->on_disk && !b->on_disk;
+	}
+	return b->page == nth_page(a->page, 1) &&
+		page_address(b->page) == page_address(a->page) + PAGE_SIZE;
+}
+
+
+/**
+* Give node a page in memory. An evicted page is brought back through the
+* fault hook if its contents are needed, otherwise a zeroed page will do.
+*/
+int store_load(asgn1_store *store, page_node *node, long page_no,
+bool need_data) {
+	if(node->page != NULL){
+		return 0;
+	}
+
+	if(node->on_disk && need_data && store->fault){
+		return store->fault(store, node, page_no);
+	}
+
+	node->page = alloc_page(GFP_KERNEL | __GFP_ZERO);
+	if(node->page == NULL){
+		printk(KERN_INFO "Memory Allocation Failed");
+		return -ENOMEM;
+	}
+	node->dirty = true;
+	store->nr_resident++;
+
+	/* Any old checksum belongs to the contents that were dropped, the
+	   zeroed page is left for the scrubber to seal. */
+	node->sealed = false;
+	return 0;
+}
+
+
+/**
+* Called before len bytes at offset of a resident page change. The old bytes
+* are taken out of the checksum, unless the page is rewritten as a whole or
+* another write is already copying into it; then it is simply left unsealed
+* and the scrubber seals it later.
+*/
+static void store_begin_change(asgn1_store *store, page_node *node,
+size_t offset, size_t len) {
+	if(!node->sealed){
+		return;
+	}
+	if(store->update == NULL || len == PAGE_SIZE || node->writers > 0){
+		node->sealed = false;
+		return;
+	}
+	store->update(node, offset, len);
+}
+
+
+/**
+* Called once the bytes passed to store_begin_change hold their new contents,
+* folds them into the checksum if the page is still sealed.
+*/
+static void store_end_change(asgn1_store *store, page_node *node,
+size_t offset, size_t len) {
+	if(node->sealed && store->update){
+		store->update(node, offset, len);
+	}
+}
+
+
+/**
+* The part of the i-th page of a run that the run covers.
+*/
+static void store_run_range(struct store_run *run, unsigned long i,
+size_t *offset, size_t *len) {
+	size_t start = i == 0 ? 0 : i * PAGE_SIZE - run->offset;  /* in the run */
+
+	*offset = i == 0 ? run->offset : 0;
+	*len = min_t(size_t, PAGE_SIZE - *offset, run->len - start);
+}
+
+
+/**
+* Hand out the run of physically contiguous pages starting at pos, covering
+* at most count bytes, pinned so it can be copied with the store unlocked.
+*
+* For a read the run stops at the end of the data, run->len is 0 once pos is
+* past it. Evicted pages are faulted in and every page is verified; a page
+* failing verification ends the run before it, or fails the call if it is
+* the first. Holes form runs of their own with no page, they read as zeroes.
+*
+* For a write the store grows to cover the whole write, but only the pages
+* of this run are backed: holes get a new block, an evicted page is only
+* read back in if the write doesn't cover all of it. The pages are counted as being written
+* until the run is put back, so the evictor and scrubber leave them alone.
+*/
+int store_get_run(asgn1_store *store, loff_t pos, size_t count, bool write,
+struct store_run *run) {
+	unsigned long page_no;    /* page number of the last page in the run */
+	size_t page_len;          /* bytes of the page being added to the run */
+	page_node *curr;
+	page_node *next;
+	size_t offset;
+	size_t len;
+	int result;
+
+	run->len = 0;
+	run->nr_pages = 0;
+	run->page = NULL;
+	run->pos = pos;
+	run->offset = pos & (PAGE_SIZE - 1);
+	run->write = write;
+
+	if(pos < 0){
+		return -EINVAL;
+	}
+
+	if(write){
+		if(count == 0){
+			return 0;
+		}
+		if(count > (size_t) (LLONG_MAX - pos)){
+			return -EFBIG;
+		}
+		/* Allocate memory for appropriate number of pages and add them to list */
+		result = store_grow(store, (pos + count + (PAGE_SIZE-1)) >> PAGE_SHIFT);
+		if(result != 0){
+			return result;
+		}
+	} else {
+		/* check pos, if beyond data_size, there is nothing to read. */
+		if(pos >= (loff_t) store->data_size){
+			return 0;
+		}
+		count = min(count, (size_t) (store->data_size - pos));
+	}
+
+	page_no = pos >> PAGE_SHIFT;
+	curr = store_find(store, page_no);
+	if(curr == NULL){
+		return 0;
+	}
+
+	page_len = min_t(size_t, PAGE_SIZE - run->offset, count);
+	if(write){
+		/* Back holes a block at a time, so the caller can keep the number of
+		   resident pages in check between runs. */
+		if(curr->page == NULL && !curr->on_disk){
+			result = store_fill(store, curr,
+			(run->offset + count + (PAGE_SIZE-1)) >> PAGE_SHIFT);
+			if(result < 0){
+				return result;
+			}
+		}
+		result = store_load(store, curr, page_no, page_len < PAGE_SIZE);
+		if(result != 0){
+			return result;
+		}
+	} else {
+		/* Bring evicted pages back in, holes stay holes. */
+		if(curr->page == NULL && curr->on_disk){
+			result = store_load(store, curr, page_no, true);
+			if(result != 0){
+				return result;
+			}
+		}
+
+		/* Refuse to hand out data that no longer matches its checksum.
+		   Pages still being written are checked once the write is done. */
+		if(store->verify && curr->writers == 0){
+			result = store->verify(curr, page_no);
+			if(result != 0){
+				return result;
+			}
+		}
+	}
+	curr->referenced = true;
+
+	/* Extend the run while the following pages are contiguous. */
+	run->first = curr;
+	run->last = curr;
+	run->len = page_len;
+	while(run->len < count){
+		next = store_next(store, run->last);
+		if(next == NULL || !pages_contiguous(run->last, next)){
+			break;
+		}
+		page_len = min_t(size_t, PAGE_SIZE, count - run->len);
+		if(write){
+			/* A partial last page starts a run of its own so it is
+			   loaded with its data, as curr. */
+			if(next->page == NULL || page_len < PAGE_SIZE){
+				break;
+			}
+		} else if(store->verify && next->writers == 0 &&
+			store->verify(next, page_no + 1) != 0){
+			break;
+		}
+		run->len += page_len;
+		next->referenced = true;
+		run->last = next;
+		page_no++;
+	}
+
+	/* Pin the pages, they may be discarded or evicted while the store is unlocked. */
+	run->page = curr->page;
+	for(next = curr; run->page != NULL; next = list_next_entry(next, list)){
+		if(write){
+			store_run_range(run, run->nr_pages, &offset, &len);
+			store_begin_change(store, next, offset, len);
+			next->writers++;
+			next->dirty = true;
+		}
+		get_page(nth_page(run->page, run->nr_pages));
+		run->nr_pages++;
+		if(next == run->last){
+			break;
+		}
+	}
+
+	return 0;
+}
+
+
+/**
+* Hand back a run from store_get_run once done bytes of it have been copied.
+* Pages written to are marked dirty and the new bytes folded into their
+* checksums, unless they were dropped from the store meanwhile.
+* nodes_valid is false if the nodes of the run have been freed since, then
+* only the pins are released.
+*/
+void store_put_run(asgn1_store *store, struct store_run *run, size_t done,
+bool nodes_valid) {
+	page_node *node = run->first;
+	unsigned long i;
+	size_t offset;
+	size_t len;
+
+	for(i = 0; nodes_valid && run->write && i < run->nr_pages; i++){
+		node->writers--;
+		if(node->page == nth_page(run->page, i)){
+			node->referenced = true;
+			node->dirty = true;
+			store_run_range(run, i, &offset, &len);
+			store_end_change(store, node, offset, len);
+		}
+		node = list_next_entry(node, list);
+	}
+
+	if(nodes_valid && run->write && done > 0){
+		store->data_size = max(store->data_size, (size_t) (run->pos + done));
+	}
+
+	for(i = 0; i < run->nr_pages; i++){
+		put_page(nth_page(run->page, i));
+	}
+}
+
+
+/**
+* This function reads contents of the store and writes to the user
+*
+* The requested range is copied in runs of physically contiguous pages, one
+* copy_to_user per run rather than one per page. If a page fails
+* verification or the user buffer faults, the data copied so far is
+* returned, or the error if nothing was copied. The caller serialises access
+* to the store for the whole call; the module drives the runs itself so it
+* can drop its lock around the copies.
+*/
+ssize_t store_read(asgn1_store *store, char __user *buf, size_t count,
+loff_t *f_pos) {
+	size_t size_read = 0;     /* size read from virtual disk in this function */
+	unsigned long not_copied; /* bytes copy_to_user failed to copy */
+	struct store_run run;
+	int result = 0;           /* error to return if nothing could be read */
+
+	while(size_read < count){
+		result = store_get_run(store, *f_pos, count - size_read, false, &run);
+		if(result != 0 || run.len == 0){
+			break;
+		}
+
+		/* use copy_to_user to copy the run to the user-space buf, holes read as zeroes */
+		if(run.page == NULL){
+			not_copied = clear_user(buf + size_read, run.len);
+		} else {
+			not_copied = copy_to_user(buf + size_read,
+			page_address(run.page) + run.offset, run.len);
+		}
+		store_put_run(store, &run, run.len - not_copied, true);
+		size_read += run.len - not_copied;
+		*f_pos += run.len - not_copied;
+
+		if(not_copied != 0){
+			result = -EFAULT;
+			break;
+		}
+	}
+
+	if(size_read == 0 && result != 0){
+		return result;
+	}
+
+	return size_read;
+}
+
+
+/**
+* This function writes from the user buffer to the store, adding pages as
+* required.
+*
+* Like store_read the data is copied in runs of contiguous pages. Discarded
+* pages are backed again as the write reaches them.
+*/
+ssize_t store_write(asgn1_store *store, const char __user *buf, size_t count,
+loff_t *f_pos) {
+	size_t size_written = 0;  /* size written to virtual disk in this function */
+	unsigned long not_copied; /* bytes copy_from_user failed to copy */
+	struct store_run run;
+	int result = 0;           /* error to return if nothing could be written */
+
+	while(size_written < count){
+		result = store_get_run(store, *f_pos, count - size_written, true, &run);
+		if(result != 0 || run.len == 0){
+			break;
+		}
+
+		not_copied = copy_from_user(page_address(run.page) + run.offset,
+		buf + size_written, run.len);
+		store_put_run(store, &run, run.len - not_copied, true);
+		size_written += run.len - not_copied;
+		*f_pos += run.len - not_copied;
+
+		if(not_copied != 0){
+			result = -EFAULT;
+			break;
+		}
+	}
+
+	if(size_written == 0 && result != 0){
+		return result;
+	}
+
+	return size_written;
+}
+
+
+/**
+* Work out the new file position for an lseek from pos, clamped to the
+* pages held by the store.
+*/
+loff_t store_seek(asgn1_store *store, loff_t pos, loff_t offset, int cmd) {
+	loff_t testpos;
+	loff_t buffer_size;   /* signed, so negative positions clamp to 0 below */
+
+	testpos = 0;
+	buffer_size = (loff_t) store->num_pages * PAGE_SIZE;
+
+	/* set testpos according to the command */
+	switch(cmd){
+	case SEEK_SET:
+		testpos = offset;
+		break;
+	case SEEK_CUR:
+		testpos = pos + offset;
+		break;
+	case SEEK_END:
+		testpos = buffer_size + offset;
+		break;
+	}
+
+	/* if testpos larger than buffer_size, set testpos to buffer_size */
+	if( testpos > buffer_size ){
+		testpos = buffer_size;
+	}
+
+	/* if testpos smaller than 0, set testpos to 0 */
+	if( testpos < 0 ){
+		testpos = 0;
+	}
+
+	return testpos;
+}
+
+
+/**
+* Discard the byte range [start, start + len). Pages completely inside the
+* range become holes and are moved onto freed, linked by page->lru, for the
+* caller to release; the partially covered pages at either end are zeroed,
+* after being faulted in if they were evicted. Holes read back as zeroes and
+* are allocated again on the next write. Returns the number of pages moved
+* to freed, or an error if a partial page could not be brought back.
+*/
+int store_discard(asgn1_store *store, loff_t start, loff_t len,
+struct list_head *freed) {
+	loff_t end;
+	loff_t page_start = 0;   /* byte offset of the current page */
+	loff_t from;
+	loff_t to;
+	int nfreed = 0;
+	int result;
+	long page_no = 0;
+	page_node *curr;
+
+	if(start < 0 || len < 0 || start > LLONG_MAX - len){
+		return -EINVAL;
+	}
+	end = start + len;
+
+	list_for_each_entry(curr, &store->mem_list, list){
+		if(page_start >= end){
+			break;
+		}
+
+		from = max(start, page_start);
+		to = min(end, page_start + (loff_t) PAGE_SIZE);
+
+		if(to > from && (curr->page != NULL || curr->on_disk)){
+			if(from == page_start && to == page_start + (loff_t) PAGE_SIZE){
+				if(curr->page != NULL){
+					list_add_tail(&curr->page->lru, freed);
+					curr->page = NULL;
+					store->nr_resident--;
+					nfreed++;
+				}
+				curr->on_disk = false;
+				curr->sealed = false;
+			} else {
+				result = store_load(store, curr, page_no, true);
+				if(result != 0){
+					return result;
+				}
+				store_begin_change(store, curr, from - page_start, to - from);
+				memset(page_address(curr->page) + (from - page_start), 0, to - from);
+				store_end_change(store, curr, from - page_start, to - from);
+				curr->dirty = true;
+			}
+		}
+
+		page_start += PAGE_SIZE;
+		page_no++;
+	}
+
+	return nfreed;
+}
@@ -0,0 +1,88 @@
+/**
+* File: asgn1_store.h
+*
+* The page store behind the asgn1 virtual ramdisk: a list of pages plus the
+* offset arithmetic used to read, write, seek and discard within it. It only
+* depends on asgn1_shim.h, so it builds both in the module and in userspace.
+*
+* None of these functions lock, the caller serialises access to a store.
+*/
+
+/* This program is free software; you can redistribute it and/or
+* modify it under the terms of the GNU General Public License
+* as published by the Free Software Foundation; either version
+* 2 of the License, or (at your option) any later version.
+*/
+
+#ifndef ASGN1_STORE_H
+#define ASGN1_STORE_H
+
+#include "asgn1_shim.h"
+
+/* Pages are allocated in physically contiguous blocks of up to 1 << STORE_MAX_ORDER. */
+#define STORE_MAX_ORDER 4
+
+/**
+* The node structure for the memory page linked list.
+*/
+typedef struct page_node_rec {
+	struct list_head list;
+	struct page *page;    /* NULL if the page is a hole or has been evicted */
+	u32 csum;             /* CRC32C of the page, only meaningful if sealed */
+	bool sealed;          /* csum matches the page contents */
+	bool corrupt;         /* a mismatch against csum has already been reported */
+	bool referenced;      /* accessed since the eviction clock hand last passed */
+	bool dirty;           /* page differs from the copy in the backing store */
+	bool on_disk;         /* backing store holds a copy, a NULL page is evicted not a hole */
+	unsigned int writers; /* writes copying into the page with the store unlocked */
+} page_node;
+
+typedef struct asgn1_store_t {
+	struct list_head mem_list;
+	unsigned long num_pages;  /* number of memory pages this store currently holds */
+	size_t data_size;     /* total data size in this store */
+	unsigned long nr_resident;  /* pages currently held in memory */
+
+	/* optional, checked before data is read from a page */
+	int (*verify)(page_node *node, long page_no);
+	/* optional, folds len bytes at offset of a sealed page in or out of its
+	   checksum, called before and after they change */
+	void (*update)(page_node *node, size_t offset, size_t len);
+	/* brings an evicted page back into memory, required if pages are ever evicted */
+	int (*fault)(struct asgn1_store_t *store, page_node *node, long page_no);
+} asgn1_store;
+
+/**
+* A run of physically contiguous pages handed out by store_get_run. Its pages
+* are pinned, so the caller can drop the lock while copying to or from user
+* space and must hand the run back with store_put_run.
+*/
+struct store_run {
+	page_node *first;         /* first and last node of the run */
+	page_node *last;
+	struct page *page;        /* first page, NULL for a run of holes */
+	unsigned long nr_pages;   /* pages pinned from page onwards */
+	loff_t pos;               /* file position of the run */
+	size_t offset;            /* offset of pos into the first page */
+	size_t len;               /* bytes covered by the run, 0 at the end of the data */
+	bool write;
+};
+
+void store_init(asgn1_store *store);
+void store_free_nodes(struct list_head *nodes);
+int store_grow(asgn1_store *store, unsigned long npages);
+int store_load(asgn1_store *store, page_node *node, long page_no,
+bool need_data);
+int store_get_run(asgn1_store *store, loff_t pos, size_t count, bool write,
+struct store_run *run);
+void store_put_run(asgn1_store *store, struct store_run *run, size_t done,
+bool nodes_valid);
+ssize_t store_read(asgn1_store *store, char __user *buf, size_t count,
+loff_t *f_pos);
+ssize_t store_write(asgn1_store *store, const char __user *buf, size_t count,
+loff_t *f_pos);
+loff_t store_seek(asgn1_store *store, loff_t pos, loff_t offset, int cmd);
+int store_discard(asgn1_store *store, loff_t start, loff_t len,
+struct list_head *freed);
+
+#endif /* ASGN1_STORE_H */
@@ -0,0 +1,304 @@
+/**
+* Microbenchmark for the asgn1 page store, built in userspace against
+* asgn1_shim.h. Run it under perf to profile lookups and copies:
+*
+*   make store_bench && perf record ./store_bench [disk MB] [ops]
+*
+* Every workload runs plain and with the CRC32C update and verify hooks the
+* module installs when loaded with integrity=1, then the overhead of the
+* checksums is shown, both measured and as the time spent in the hooks. Each run gets a process of its own, since a heap left
+* behind by an earlier run skews the next by more than the checksums cost,
+* and the best of REPEAT runs of each counts. The CRC is the shim's, which
+* like the kernel's crc32c-intel runs three streams at once where the CPU
+* allows.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+
+#include "asgn1_store.h"
+
+#define IO_SIZE 4096
+#define REPEAT 5        /* runs of each configuration, the fastest counts */
+
+enum { SEQ_WRITE, SEAL, SEQ_READ, RAND_READ, RAND_WRITE, REFILL, NR_WORKLOADS };
+
+static const char *workloads[NR_WORKLOADS] = {
+    "seq write 1M", "scrubber seal", "seq read 1M", "rand read 4k",
+    "rand write 4k", "discard+refill 1M",
+};
+
+struct result {
+    double secs[NR_WORKLOADS];
+    double hook_secs[NR_WORKLOADS];  /* spent in the checksum hooks */
+    unsigned long ops[NR_WORKLOADS];
+    unsigned long bytes[NR_WORKLOADS];
+};
+
+static double now (void)
+{
+    struct timespec ts;
+
+    clock_gettime (CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void report (const char *name, double secs, unsigned long ops,
+                    unsigned long bytes)
+{
+    printf ("%-18s %10lu ops %8.3f s %10.0f ops/s %8.1f MB/s\n", name, ops,
+            secs, ops / secs, bytes / secs / (1024 * 1024));
+}
+
+static double hook_secs;
+
+/* As in the module, x^(8n) modulo the polynomial for n < PAGE_SIZE. */
+static u32 csum_shift[PAGE_SIZE];
+
+static u32 csum_multiply (u32 a, u32 b)
+{
+    u32 product = 0;
+    int i;
+
+    for (i = 31; i >= 0; i--) {
+        product ^= b & -((a >> i) & 1);
+        b = (b >> 1) ^ (0x82f63b78 & -(b & 1));
+    }
+    return product;
+}
+
+static void crc_update (page_node *node, size_t offset, size_t len)
+{
+    double t = now ();
+
+    node->csum ^= csum_multiply (crc32c (0, (char *)page_address (node->page) + offset, len),
+                                 csum_shift[PAGE_SIZE - offset - len]);
+    hook_secs += now () - t;
+}
+
+static int crc_verify (page_node *node, long page_no)
+{
+    double t = now ();
+    int result = 0;
+
+    (void)page_no;
+    if (node->page != NULL && node->sealed &&
+        crc32c (~0U, page_address (node->page), PAGE_SIZE) != node->csum)
+        result = -EIO;
+    hook_secs += now () - t;
+    return result;
+}
+
+/* What the scrubber does in the background to pages written in full. */
+static unsigned long seal_all (asgn1_store *store)
+{
+    unsigned long n = 0;
+    page_node *node;
+
+    list_for_each_entry(node, &store->mem_list, list) {
+        if (node->page != NULL && !node->sealed) {
+            node->csum = crc32c (~0U, page_address (node->page), PAGE_SIZE);
+            node->sealed = true;
+            n++;
+        }
+    }
+    return n;
+}
+
+static void record (struct result *res, int w, double start, unsigned long ops,
+                    unsigned long bytes)
+{
+    res->secs[w] = now () - start;
+    res->hook_secs[w] = hook_secs;
+    hook_secs = 0;
+    res->ops[w] = ops;
+    res->bytes[w] = bytes;
+}
+
+static void run (size_t disk_size, unsigned long ops, char *buf, size_t chunk,
+                 bool checksums, struct result *res)
+{
+    unsigned long i;
+    unsigned long n;
+    asgn1_store store;
+    loff_t pos;
+    double t;
+
+    srandom (1);
+    store_init (&store);
+    if (checksums) {
+        store.update = crc_update;
+        store.verify = crc_verify;
+    }
+
+    /* Sequential fill in large writes, this is also the allocation cost. */
+    hook_secs = 0;
+    t = now ();
+    for (pos = 0; (size_t)pos < disk_size; ) {
+        if (store_write (&store, buf, chunk, &pos) != (ssize_t)chunk) {
+            fprintf (stderr, "sequential write failed\n");
+            exit (1);
+        }
+    }
+    record (res, SEQ_WRITE, t, disk_size / chunk, disk_size);
+
+    /* Not on the write path, but reads only verify pages sealed since. */
+    t = now ();
+    n = checksums ? seal_all (&store) : 0;
+    record (res, SEAL, t, n, n * PAGE_SIZE);
+
+    t = now ();
+    pos = 0;
+    while (store_read (&store, buf, chunk, &pos) > 0)
+        ;
+    record (res, SEQ_READ, t, disk_size / chunk, disk_size);
+
+    t = now ();
+    for (i = 0; i < ops; i++) {
+        pos = (random () % (disk_size / IO_SIZE)) * IO_SIZE;
+        store_read (&store, buf, IO_SIZE, &pos);
+    }
+    record (res, RAND_READ, t, ops, ops * IO_SIZE);
+
+    /* Unaligned, so every write is two partial pages folded into their
+       checksums. */
+    t = now ();
+    for (i = 0; i < ops; i++) {
+        pos = random () % (disk_size - IO_SIZE);
+        store_write (&store, buf, IO_SIZE, &pos);
+    }
+    record (res, RAND_WRITE, t, ops, ops * IO_SIZE);
+
+    /* Allocation churn: repeatedly drop and refill a range of the disk. */
+    t = now ();
+    for (i = 0; i < ops / 16; i++) {
+        LIST_HEAD(freed);
+        struct page *page;
+        struct page *next;
+        loff_t start = (random () % (disk_size / chunk)) * chunk;
+
+        store_discard (&store, start, chunk, &freed);
+        list_for_each_entry_safe(page, next, &freed, lru) {
+            list_del (&page->lru);
+            __free_page (page);
+        }
+        pos = start;
+        store_write (&store, buf, chunk, &pos);
+    }
+    record (res, REFILL, t, ops / 16, ops / 16 * chunk);
+
+    store_free_nodes (&store.mem_list);
+}
+
+/* run() in a child process, keeping the best time of each workload. */
+static void run_child (size_t disk_size, unsigned long ops, char *buf,
+                       size_t chunk, bool checksums, struct result *best,
+                       struct result *shared, bool first)
+{
+    pid_t pid;
+    int status;
+    int i;
+
+    pid = fork ();
+    if (pid < 0) {
+        perror ("fork");
+        exit (1);
+    }
+    if (pid == 0) {
+        run (disk_size, ops, buf, chunk, checksums, shared);
+        _exit (0);
+    }
+    if (waitpid (pid, &status, 0) < 0 || !WIFEXITED(status) ||
+        WEXITSTATUS(status) != 0) {
+        fprintf (stderr, "benchmark run failed\n");
+        exit (1);
+    }
+
+    for (i = 0; i < NR_WORKLOADS; i++) {
+        if (first || shared->secs[i] < best->secs[i])
+            best->secs[i] = shared->secs[i];
+        if (first || shared->hook_secs[i] < best->hook_secs[i])
+            best->hook_secs[i] = shared->hook_secs[i];
+    }
+    memcpy (best->ops, shared->ops, sizeof (best->ops));
+    memcpy (best->bytes, shared->bytes, sizeof (best->bytes));
+}
+
+static void show (const char *label, struct result *res)
+{
+    int i;
+
+    printf ("%s:\n", label);
+    for (i = 0; i < NR_WORKLOADS; i++)
+        if (res->ops[i] > 0)
+            report (workloads[i], res->secs[i], res->ops[i], res->bytes[i]);
+}
+
+int main (int argc, char **argv)
+{
+    size_t disk_size = 64UL << 20;
+    unsigned long ops = 20000;
+    char *buf;
+    size_t chunk = 1UL << 20;
+    const char *impl = "crc32c software";
+    struct result plain;
+    struct result crc;
+    struct result *shared;
+    unsigned long n;
+    int i;
+
+    if (argc > 1)
+        disk_size = strtoul (argv[1], NULL, 0) << 20;
+    if (argc > 2)
+        ops = strtoul (argv[2], NULL, 0);
+
+    if ((buf = malloc (chunk)) == NULL) {
+        perror ("malloc");
+        return 1;
+    }
+    memset (buf, 0xa5, chunk);
+
+    shared = mmap (NULL, sizeof (*shared), PROT_READ | PROT_WRITE,
+                   MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if (shared == MAP_FAILED) {
+        perror ("mmap");
+        return 1;
+    }
+
+    csum_shift[0] = 1U << 31;
+    for (n = 1; n < PAGE_SIZE; n++)
+        csum_shift[n] = __crc32c_le_shift (csum_shift[n - 1], 1);
+
+#if defined(__x86_64__)
+    if (__builtin_cpu_supports ("sse4.2") && __builtin_cpu_supports ("pclmul"))
+        impl = "crc32c sse4.2 3-way";
+#endif
+
+    /* Alternate the two, so drift in the machine's speed hits both alike. */
+    for (i = 0; i < REPEAT; i++) {
+        run_child (disk_size, ops, buf, chunk, false, &plain, shared, i == 0);
+        run_child (disk_size, ops, buf, chunk, true, &crc, shared, i == 0);
+    }
+    show ("plain", &plain);
+    printf ("\n");
+    show (impl, &crc);
+
+    /* The difference in wall time is only as good as the machine is quiet,
+       time spent in the hooks against the plain run is the steadier figure. */
+    printf ("\n%-18s %10s %10s\n", "overhead", "measured", "in hooks");
+    for (i = 0; i < NR_WORKLOADS; i++)
+        if (i != SEAL)
+            printf ("%-18s %+9.1f%% %+9.1f%%\n", workloads[i],
+                    (crc.secs[i] / plain.secs[i] - 1) * 100,
+                    crc.hook_secs[i] / plain.secs[i] * 100);
+
+    munmap (shared, sizeof (*shared));
+    free (buf);
+    return 0;
+}
@@ -0,0 +1,694 @@
+/**
+* Unit test for the asgn1 page store, built in userspace against
+* asgn1_shim.h so it runs without root or the module loaded.
+*
+*   make test
+*   make test USER_CFLAGS="-g -O1 -fsanitize=address"
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "asgn1_store.h"
+
+#define CHECK(cond) do { \
+        if (!(cond)) { \
+            fprintf (stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond); \
+            exit (1); \
+        } \
+    } while (0)
+
+static void fill (char *buf, size_t len, unsigned seed)
+{
+    size_t i;
+
+    for (i = 0; i < len; i++) {
+        buf[i] = (char)(seed + i * 31);
+    }
+}
+
+static int count_pages (asgn1_store *store)
+{
+    page_node *curr;
+    int n = 0;
+
+    list_for_each_entry(curr, &store->mem_list, list) {
+        n++;
+    }
+    return n;
+}
+
+static void test_write_read (void)
+{
+    asgn1_store store;
+    size_t len = 3 * PAGE_SIZE + 123;
+    char *buf = malloc (len);
+    char *out = malloc (len);
+    loff_t pos = 0;
+
+    store_init (&store);
+    fill (buf, len, 1);
+
+    CHECK(store_write (&store, buf, len, &pos) == (ssize_t)len);
+    CHECK(pos == (loff_t)len);
+    CHECK(store.num_pages == 4);
+    CHECK(count_pages (&store) == 4);
+    CHECK(store.data_size == len);
+
+    pos = 0;
+    CHECK(store_read (&store, out, len, &pos) == (ssize_t)len);
+    CHECK(memcmp (buf, out, len) == 0);
+
+    /* Reading at the end of the data returns nothing. */
+    CHECK(store_read (&store, out, len, &pos) == 0);
+
+    store_free_nodes (&store.mem_list);
+    free (buf);
+    free (out);
+    printf ("write/read round trip ok\n");
+}
+
+static void test_unaligned (void)
+{
+    asgn1_store store;
+    size_t len = 2 * PAGE_SIZE;
+    char *buf = malloc (len);
+    char *patch = malloc (PAGE_SIZE);
+    char *out = malloc (len);
+    loff_t pos = 0;
+
+    store_init (&store);
+    fill (buf, len, 7);
+    CHECK(store_write (&store, buf, len, &pos) == (ssize_t)len);
+
+    /* Overwrite a range straddling the page boundary. */
+    fill (patch, PAGE_SIZE, 99);
+    pos = PAGE_SIZE - 100;
+    CHECK(store_write (&store, patch, 200, &pos) == 200);
+    memcpy (buf + PAGE_SIZE - 100, patch, 200);
+    CHECK(store.num_pages == 2);
+    CHECK(store.data_size == len);
+
+    pos = PAGE_SIZE - 150;
+    CHECK(store_read (&store, out, 300, &pos) == 300);
+    CHECK(memcmp (buf + PAGE_SIZE - 150, out, 300) == 0);
+    CHECK(pos == PAGE_SIZE + 150);
+
+    /* A short read at the end of the data is truncated. */
+    pos = len - 10;
+    CHECK(store_read (&store, out, 100, &pos) == 10);
+    CHECK(memcmp (buf + len - 10, out, 10) == 0);
+
+    store_free_nodes (&store.mem_list);
+    free (buf);
+    free (patch);
+    free (out);
+    printf ("unaligned access ok\n");
+}
+
+static void test_gap (void)
+{
+    asgn1_store store;
+    size_t len = 2 * PAGE_SIZE + 20;
+    char *buf = malloc (len);
+    char *out = malloc (len);
+    char *zero = calloc (1, len);
+    loff_t pos = 2 * PAGE_SIZE + 10;
+
+    /* Writing past the end leaves a gap that must read back as zeroes,
+       not as whatever the allocator handed out. */
+    store_init (&store);
+    fill (buf, 10, 5);
+    CHECK(store_write (&store, buf, 10, &pos) == 10);
+    CHECK(store.data_size == len);
+
+    /* The gap is made of holes, only the written page takes memory. */
+    CHECK(store.num_pages == 3);
+    CHECK(store.nr_resident == 1);
+
+    pos = 0;
+    CHECK(store_read (&store, out, len, &pos) == (ssize_t)len);
+    CHECK(memcmp (out, zero, 2 * PAGE_SIZE + 10) == 0);
+    CHECK(memcmp (out + 2 * PAGE_SIZE + 10, buf, 10) == 0);
+    CHECK(store.nr_resident == 1);
+
+    store_free_nodes (&store.mem_list);
+    free (buf);
+    free (out);
+    free (zero);
+    printf ("gap ok\n");
+}
+
+static void test_seek (void)
+{
+    asgn1_store store;
+    char buf[100];
+    loff_t pos = 0;
+
+    store_init (&store);
+    fill (buf, sizeof (buf), 3);
+    CHECK(store_write (&store, buf, sizeof (buf), &pos) == sizeof (buf));
+
+    CHECK(store_seek (&store, 0, 50, SEEK_SET) == 50);
+    CHECK(store_seek (&store, 50, 10, SEEK_CUR) == 60);
+    CHECK(store_seek (&store, 50, -100, SEEK_CUR) == 0);
+    CHECK(store_seek (&store, 0, 0, SEEK_END) == (loff_t)PAGE_SIZE);
+    CHECK(store_seek (&store, 0, 10, SEEK_END) == (loff_t)PAGE_SIZE);
+    CHECK(store_seek (&store, 0, 10 * PAGE_SIZE, SEEK_SET) == (loff_t)PAGE_SIZE);
+
+    store_free_nodes (&store.mem_list);
+    printf ("seek ok\n");
+}
+
+static void test_discard (void)
+{
+    asgn1_store store;
+    size_t len = 4 * PAGE_SIZE;
+    char *buf = malloc (len);
+    char *out = malloc (len);
+    LIST_HEAD(freed);
+    struct page *page;
+    struct page *next;
+    loff_t pos = 0;
+    int n = 0;
+
+    store_init (&store);
+    fill (buf, len, 5);
+    CHECK(store_write (&store, buf, len, &pos) == (ssize_t)len);
+
+    /* Frees pages 1 and 2 and zeroes the tail of page 0 and head of page 3. */
+    CHECK(store_discard (&store, PAGE_SIZE - 10, 2 * PAGE_SIZE + 20, &freed) == 2);
+    list_for_each_entry_safe(page, next, &freed, lru) {
+        list_del (&page->lru);
+        __free_page (page);
+        n++;
+    }
+    CHECK(n == 2);
+    memset (buf + PAGE_SIZE - 10, 0, 2 * PAGE_SIZE + 20);
+
+    /* Holes keep their place in the list and read as zeroes. */
+    CHECK(store.num_pages == 4);
+    pos = 0;
+    CHECK(store_read (&store, out, len, &pos) == (ssize_t)len);
+    CHECK(memcmp (buf, out, len) == 0);
+
+    /* Writing into a hole backs it again. */
+    fill (buf + PAGE_SIZE + 5, 10, 11);
+    pos = PAGE_SIZE + 5;
+    CHECK(store_write (&store, buf + PAGE_SIZE + 5, 10, &pos) == 10);
+    pos = 0;
+    CHECK(store_read (&store, out, len, &pos) == (ssize_t)len);
+    CHECK(memcmp (buf, out, len) == 0);
+
+    CHECK(store_discard (&store, -1, 10, &freed) == -EINVAL);
+
+    store_free_nodes (&store.mem_list);
+    free (buf);
+    free (out);
+    printf ("discard ok\n");
+}
+
+static int bad_page = -1;
+static int bad_verifies;
+
+static int fake_verify (page_node *node, long page_no)
+{
+    (void)node;
+    if (page_no != bad_page)
+        return 0;
+    bad_verifies++;
+    return -EIO;
+}
+
+static void test_verify (void)
+{
+    asgn1_store store;
+    size_t len = 3 * PAGE_SIZE;
+    char *buf = malloc (len);
+    char *out = malloc (len);
+    loff_t pos = 0;
+
+    store_init (&store);
+    store.verify = fake_verify;
+    fill (buf, len, 13);
+    CHECK(store_write (&store, buf, len, &pos) == (ssize_t)len);
+
+    /* A bad page stops the read there, or fails it outright. */
+    bad_page = 1;
+    pos = 0;
+    CHECK(store_read (&store, out, len, &pos) == (ssize_t)PAGE_SIZE);
+    CHECK(store_read (&store, out, len, &pos) == -EIO);
+
+    /* Writes never verify, a partial overwrite leaves the page bad. */
+    bad_verifies = 0;
+    pos = PAGE_SIZE + 1;
+    CHECK(store_write (&store, buf, 10, &pos) == 10);
+    pos = 0;
+    CHECK(store_write (&store, buf, PAGE_SIZE + 10, &pos) == (ssize_t)(PAGE_SIZE + 10));
+    CHECK(bad_verifies == 0);
+    pos = 0;
+    CHECK(store_read (&store, out, len, &pos) == (ssize_t)PAGE_SIZE);
+
+    store_free_nodes (&store.mem_list);
+    free (buf);
+    free (out);
+    printf ("verify hook ok\n");
+}
+
+/* The module's checksum hooks, CRC32C over the whole page. */
+static u32 page_crc (page_node *node)
+{
+    return crc32c (~0U, page_address (node->page), PAGE_SIZE);
+}
+
+static void crc_update (page_node *node, size_t offset, size_t len)
+{
+    node->csum ^= __crc32c_le_shift (crc32c (0, (char *)page_address (node->page) + offset, len),
+                                     PAGE_SIZE - offset - len);
+}
+
+static int crc_verify (page_node *node, long page_no)
+{
+    (void)page_no;
+    if (node->page == NULL || !node->sealed) {
+        return 0;
+    }
+    return page_crc (node) == node->csum ? 0 : -EIO;
+}
+
+/* What the scrubber does to pages left unsealed. */
+static void seal_all (asgn1_store *store)
+{
+    page_node *node;
+
+    list_for_each_entry(node, &store->mem_list, list) {
+        if (node->page != NULL && !node->sealed) {
+            node->csum = page_crc (node);
+            node->sealed = true;
+        }
+    }
+}
+
+static page_node *nth_node (asgn1_store *store, unsigned long n)
+{
+    page_node *node;
+
+    list_for_each_entry(node, &store->mem_list, list) {
+        if (n-- == 0) {
+            return node;
+        }
+    }
+    return NULL;
+}
+
+static void test_discard_sealed (void)
+{
+    asgn1_store store;
+    size_t len = 3 * PAGE_SIZE;
+    char *buf = malloc (len);
+    char *out = malloc (len);
+    LIST_HEAD(freed);
+    struct page *page;
+    struct page *next;
+    loff_t pos = 0;
+
+    store_init (&store);
+    store.verify = crc_verify;
+    store.update = crc_update;
+    fill (buf, len, 37);
+    CHECK(store_write (&store, buf, len, &pos) == (ssize_t)len);
+    seal_all (&store);
+
+    /* Backing a discarded page again must not trip over its old checksum. */
+    CHECK(store_discard (&store, PAGE_SIZE, PAGE_SIZE, &freed) == 1);
+    memset (buf + PAGE_SIZE, 0, PAGE_SIZE);
+    fill (buf + PAGE_SIZE + 5, 10, 41);
+    pos = PAGE_SIZE + 5;
+    CHECK(store_write (&store, buf + PAGE_SIZE + 5, 10, &pos) == 10);
+
+    /* Zeroing part of a sealed page keeps its checksum current. */
+    CHECK(store_discard (&store, 100, 200, &freed) == 0);
+    memset (buf + 100, 0, 200);
+    CHECK(nth_node (&store, 0)->sealed);
+
+    pos = 0;
+    CHECK(store_read (&store, out, len, &pos) == (ssize_t)len);
+    CHECK(memcmp (buf, out, len) == 0);
+
+    list_for_each_entry_safe(page, next, &freed, lru) {
+        list_del (&page->lru);
+        __free_page (page);
+    }
+    store_free_nodes (&store.mem_list);
+    free (buf);
+    free (out);
+    printf ("discard with checksums ok\n");
+}
+
+static void test_update (void)
+{
+    asgn1_store store;
+    size_t len = 3 * PAGE_SIZE;
+    char *buf = malloc (len);
+    char *out = malloc (len);
+    page_node *node;
+    loff_t pos = 0;
+    int i;
+
+    store_init (&store);
+    store.verify = crc_verify;
+    store.update = crc_update;
+    fill (buf, len, 53);
+    CHECK(store_write (&store, buf, len, &pos) == (ssize_t)len);
+
+    /* Whole pages written are left for the scrubber to seal. */
+    list_for_each_entry(node, &store.mem_list, list) {
+        CHECK(!node->sealed);
+    }
+    seal_all (&store);
+
+    /* Partial writes fold into the checksum, a page written in full is unsealed. */
+    fill (buf + 10, 30, 59);
+    pos = 10;
+    CHECK(store_write (&store, buf + 10, 30, &pos) == 30);
+    fill (buf + PAGE_SIZE - 7, PAGE_SIZE + 20, 61);
+    pos = PAGE_SIZE - 7;
+    CHECK(store_write (&store, buf + PAGE_SIZE - 7, PAGE_SIZE + 20, &pos) ==
+          (ssize_t)(PAGE_SIZE + 20));
+    CHECK(!nth_node (&store, 1)->sealed);
+    for (i = 0; i < 3; i += 2) {
+        node = nth_node (&store, i);
+        CHECK(node->sealed && node->csum == page_crc (node));
+    }
+    seal_all (&store);
+    pos = 0;
+    CHECK(store_read (&store, out, len, &pos) == (ssize_t)len);
+    CHECK(memcmp (buf, out, len) == 0);
+
+    /* Corruption outside a partial write is still caught... */
+    ((char *)page_address (nth_node (&store, 0)->page))[2000] ^= 1;
+    pos = 50;
+    CHECK(store_write (&store, buf + 50, 10, &pos) == 10);
+    pos = 0;
+    CHECK(store_read (&store, out, PAGE_SIZE, &pos) == -EIO);
+
+    /* ...and so is corruption the write went over. */
+    ((char *)page_address (nth_node (&store, 2)->page))[300] ^= 1;
+    pos = 2 * PAGE_SIZE + 290;
+    CHECK(store_write (&store, buf + 2 * PAGE_SIZE + 290, 20, &pos) == 20);
+    pos = 2 * PAGE_SIZE;
+    CHECK(store_read (&store, out, PAGE_SIZE, &pos) == -EIO);
+
+    store_free_nodes (&store.mem_list);
+    free (buf);
+    free (out);
+    printf ("incremental checksums ok\n");
+}
+
+static void test_runs (void)
+{
+    asgn1_store store;
+    size_t len = 40 * PAGE_SIZE + 77;
+    char *buf = malloc (len);
+    char *out = malloc (len);
+    LIST_HEAD(freed);
+    struct page *page;
+    struct page *next;
+    page_node *curr;
+    page_node *prev = NULL;
+    loff_t pos = 0;
+    int contiguous = 0;
+
+    store_init (&store);
+    fill (buf, len, 17);
+    CHECK(store_write (&store, buf, len, &pos) == (ssize_t)len);
+    CHECK(store.num_pages == 41);
+
+    /* 41 pages arrive as blocks of 16, 16, 8 and 1 pages. */
+    list_for_each_entry(curr, &store.mem_list, list) {
+        if (prev && page_address (curr->page) == page_address (prev->page) + PAGE_SIZE) {
+            contiguous++;
+        }
+        prev = curr;
+    }
+    CHECK(contiguous >= 41 - 4);
+
+    /* Punch holes so runs mix pages, holes and page boundaries. */
+    CHECK(store_discard (&store, 5 * PAGE_SIZE, 3 * PAGE_SIZE, &freed) == 3);
+    CHECK(store_discard (&store, 17 * PAGE_SIZE + 9, 2 * PAGE_SIZE, &freed) == 1);
+    list_for_each_entry_safe(page, next, &freed, lru) {
+        list_del (&page->lru);
+        __free_page (page);
+    }
+    memset (buf + 5 * PAGE_SIZE, 0, 3 * PAGE_SIZE);
+    memset (buf + 17 * PAGE_SIZE + 9, 0, 2 * PAGE_SIZE);
+
+    pos = 123;
+    CHECK(store_read (&store, out, len, &pos) == (ssize_t)(len - 123));
+    CHECK(memcmp (buf + 123, out, len - 123) == 0);
+
+    /* Rewrite across the holes and read back in odd sized pieces. */
+    fill (buf + 4 * PAGE_SIZE + 1, 20 * PAGE_SIZE, 23);
+    pos = 4 * PAGE_SIZE + 1;
+    CHECK(store_write (&store, buf + 4 * PAGE_SIZE + 1, 20 * PAGE_SIZE, &pos) == (ssize_t)(20 * PAGE_SIZE));
+    for (pos = 0; (size_t)pos < len; ) {
+        loff_t start = pos;
+        ssize_t n = store_read (&store, out, 3 * PAGE_SIZE + 5, &pos);
+
+        CHECK(n > 0);
+        CHECK(pos == start + n);
+        CHECK(memcmp (buf + start, out, n) == 0);
+    }
+
+    store_free_nodes (&store.mem_list);
+    free (buf);
+    free (out);
+    printf ("contiguous runs ok\n");
+}
+
+static void free_pages (struct list_head *freed)
+{
+    struct page *page;
+    struct page *next;
+
+    list_for_each_entry_safe(page, next, freed, lru) {
+        list_del (&page->lru);
+        __free_page (page);
+    }
+}
+
+static void test_pinned (void)
+{
+    asgn1_store store;
+    size_t len = 4 * PAGE_SIZE;
+    char *buf = malloc (len);
+    char *out = malloc (len);
+    char *zero = calloc (1, len);
+    struct store_run run;
+    LIST_HEAD(freed);
+    page_node *curr;
+    loff_t pos = 0;
+
+    store_init (&store);
+    fill (buf, len, 29);
+    CHECK(store_write (&store, buf, len, &pos) == (ssize_t)len);
+
+    /* A run stays usable while its pages are discarded under it, the
+       module copies with the store unlocked. The write is lost, the
+       discard came after the run was handed out. */
+    CHECK(store_get_run (&store, PAGE_SIZE, 2 * PAGE_SIZE, true, &run) == 0);
+    CHECK(run.len > 0 && run.nr_pages >= 1);
+    CHECK(run.first->writers == 1);
+    CHECK(store_discard (&store, 0, len, &freed) == 4);
+    free_pages (&freed);
+    memcpy (page_address (run.page) + run.offset, buf, run.len);
+    store_put_run (&store, &run, run.len, true);
+    list_for_each_entry(curr, &store.mem_list, list) {
+        CHECK(curr->writers == 0);
+        CHECK(curr->page == NULL);
+    }
+    pos = 0;
+    CHECK(store_read (&store, out, len, &pos) == (ssize_t)len);
+    CHECK(memcmp (out, zero, len) == 0);
+
+    /* A write only backs the pages of the run it hands out, so memory can
+       be reclaimed between runs. */
+    store_free_nodes (&store.mem_list);
+    store_init (&store);
+    CHECK(store_get_run (&store, 0, 40 * PAGE_SIZE, true, &run) == 0);
+    CHECK(store.num_pages == 40);
+    CHECK(store.nr_resident <= 1UL << STORE_MAX_ORDER);
+    CHECK(run.len <= store.nr_resident * PAGE_SIZE);
+    store_put_run (&store, &run, run.len, true);
+
+    /* After a wipe the nodes are gone, only the pins are dropped. */
+    pos = 0;
+    CHECK(store_write (&store, buf, len, &pos) == (ssize_t)len);
+    CHECK(store_get_run (&store, 0, len, false, &run) == 0);
+    store_free_nodes (&store.mem_list);
+    store_init (&store);
+    CHECK(memcmp (page_address (run.page), buf, run.len) == 0);
+    store_put_run (&store, &run, run.len, false);
+
+    free (buf);
+    free (out);
+    free (zero);
+    printf ("pinned runs ok\n");
+}
+
+static void test_bounds (void)
+{
+    asgn1_store store;
+    char buf[16];
+    loff_t pos;
+
+    store_init (&store);
+
+    /* Writes that would run past the largest offset fail without allocating. */
+    pos = LLONG_MAX - 4;
+    CHECK(store_write (&store, buf, sizeof (buf), &pos) == -EFBIG);
+    CHECK(store.num_pages == 0);
+
+    pos = -1;
+    CHECK(store_write (&store, buf, sizeof (buf), &pos) == -EINVAL);
+    CHECK(store_read (&store, buf, sizeof (buf), &pos) == -EINVAL);
+
+    /* Offsets past 4 GB are not truncated, the read is just beyond the data. */
+    pos = 5LL << 30;
+    CHECK(store_read (&store, buf, sizeof (buf), &pos) == 0);
+    CHECK(store_seek (&store, 0, 5LL << 30, SEEK_SET) == 0);
+
+    printf ("64-bit bounds ok\n");
+}
+
+/* A fake backing store, evicted pages are kept in an array by page number. */
+static char *backing;
+static int faults;
+
+static int fake_fault (asgn1_store *store, page_node *node, long page_no)
+{
+    node->page = alloc_page (GFP_KERNEL);
+    if (node->page == NULL) {
+        return -ENOMEM;
+    }
+    memcpy (page_address (node->page), backing + page_no * PAGE_SIZE, PAGE_SIZE);
+    node->dirty = false;
+    store->nr_resident++;
+    faults++;
+    return 0;
+}
+
+static void evict (asgn1_store *store, long nr)
+{
+    page_node *node = list_first_entry (&store->mem_list, page_node, list);
+    long page_no = nr;
+
+    while (page_no-- > 0) {
+        node = list_next_entry (node, list);
+    }
+    CHECK(node->page != NULL);
+    if (node->dirty || !node->on_disk) {
+        memcpy (backing + nr * PAGE_SIZE, page_address (node->page), PAGE_SIZE);
+    }
+    __free_page (node->page);
+    node->page = NULL;
+    node->on_disk = true;
+    node->dirty = false;
+    store->nr_resident--;
+}
+
+static int resident (asgn1_store *store)
+{
+    page_node *curr;
+    int n = 0;
+
+    list_for_each_entry(curr, &store->mem_list, list) {
+        if (curr->page != NULL) {
+            n++;
+        }
+    }
+    return n;
+}
+
+static void test_tiering (void)
+{
+    asgn1_store store;
+    size_t len = 8 * PAGE_SIZE;
+    char *buf = malloc (len);
+    char *out = malloc (len);
+    LIST_HEAD(freed);
+    struct page *page;
+    struct page *next;
+    loff_t pos = 0;
+    long i;
+
+    backing = calloc (8, PAGE_SIZE);
+    store_init (&store);
+    store.fault = fake_fault;
+    fill (buf, len, 29);
+    CHECK(store_write (&store, buf, len, &pos) == (ssize_t)len);
+    CHECK(store.nr_resident == 8);
+
+    for (i = 2; i <= 7; i++) {
+        evict (&store, i);
+    }
+    CHECK(store.nr_resident == 2);
+    CHECK(resident (&store) == 2);
+
+    /* Reading faults every evicted page back in once. */
+    faults = 0;
+    pos = 0;
+    CHECK(store_read (&store, out, 5 * PAGE_SIZE, &pos) == (ssize_t)(5 * PAGE_SIZE));
+    CHECK(memcmp (buf, out, 5 * PAGE_SIZE) == 0);
+    CHECK(faults == 3);
+    CHECK(store.nr_resident == 5);
+
+    /* A full page overwrite doesn't need the old contents, a partial one does. */
+    faults = 0;
+    fill (buf + 5 * PAGE_SIZE, PAGE_SIZE + 10, 31);
+    pos = 5 * PAGE_SIZE;
+    CHECK(store_write (&store, buf + 5 * PAGE_SIZE, PAGE_SIZE + 10, &pos) == (ssize_t)(PAGE_SIZE + 10));
+    CHECK(faults == 1);
+
+    /* Discarding an evicted page forgets it, partially discarding one faults it in. */
+    evict (&store, 6);
+    faults = 0;
+    CHECK(store_discard (&store, 6 * PAGE_SIZE, PAGE_SIZE + 100, &freed) == 0);
+    CHECK(faults == 1);
+    memset (buf + 6 * PAGE_SIZE, 0, PAGE_SIZE + 100);
+
+    pos = 0;
+    CHECK(store_read (&store, out, len, &pos) == (ssize_t)len);
+    CHECK(memcmp (buf, out, len) == 0);
+    CHECK(faults == 1);
+    CHECK(store.nr_resident == (unsigned long)resident (&store));
+
+    list_for_each_entry_safe(page, next, &freed, lru) {
+        list_del (&page->lru);
+        __free_page (page);
+    }
+    store_free_nodes (&store.mem_list);
+    free (backing);
+    free (buf);
+    free (out);
+    printf ("tiering ok\n");
+}
+
+int main (void)
+{
+    test_write_read ();
+    test_unaligned ();
+    test_gap ();
+    test_seek ();
+    test_discard ();
+    test_verify ();
+    test_discard_sealed ();
+    test_update ();
+    test_runs ();
+    test_pinned ();
+    test_bounds ();
+    test_tiering ();
+    printf ("all page store tests passed\n");
+    return 0;
+}